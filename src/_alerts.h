@@ -2,6 +2,7 @@
 
 #include "_classtype.h"
 #include "_common.h"
+#include "_latency.h"
 
 enum class _AlertState : uint8_t {
   Idle          = 0,
@@ -85,6 +86,8 @@ private:
 public:
   _PrevAlert PrevAlert;
 
+  _Trace Trace;
+
   ulong StartMillis = 0;
   float StartValue  = 0;
 
@@ -139,6 +142,14 @@ public:
     _StateChanged();
   }
 
+  void setTrace(ulong SampleMicros) {
+    Trace.SubType        = SubType();
+    Trace.SampleMicros   = SampleMicros;
+    Trace.DecisionMicros = micros();
+    Trace.RelayMicros    = 0;
+    Trace.IsValid        = (SampleMicros > 0);
+  }
+
   bool StateIs(_AlertState Value) {
     return (_State == Value);
   }
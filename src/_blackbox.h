@@ -0,0 +1,105 @@
+#pragma once
+
+#include "_common.h"
+#include "_flashlog.h"
+
+#define BLACKBOX_LABEL          "blackbox"
+#define BLACKBOX_SUBTYPE        0x41
+#define BLACKBOX_MAGIC          0x31424C46 // "FLB1": сектора бывшей истории в этом месте раздела - не наши
+#define BLACKBOX_BOOT_TIME      0x80    // флаг вида: время - millis() от старта, RTC ещё не синхронизирована
+#define BLACKBOX_CHANNELS       6       // каналы графиков, см. _PlotList::Channel
+#define BLACKBOX_EVENTS_HOUR    60      // запас на включения устройств и старты
+
+// Вид записи - старший байт канала _FlashRecord, источник - младший
+enum class _BlackBoxKind : uint8_t {
+  Boot   = 0, // отметка старта, Value = 0
+  Sample = 1, // источник - канал графика (см. _PlotList::Channel), Value - показание с поправкой
+  Event  = 2  // источник - _SubType устройства, Value - 1 включено / 0 выключено
+};
+
+// Бортовой самописец: сырые показания и включения устройств в своём разделе флеша, без прореживания.
+// Запись 16 байт, на флеш уходят пачками в окне persist; раскладка и разбор дампа - tools/blackbox_decode.py
+class _BlackBox {
+private:
+  _FlashLog _log;
+
+  ulong _sampleMillis = 2000; // период опроса датчиков - для оценки глубины записи
+
+  bool _Put(_BlackBoxKind Kind, uint8_t Source, float Value) {
+    const uint16_t _channel = (static_cast<uint16_t>(Kind) << 8) | Source;
+
+    if (sett.rtc.synced())
+      return _log.append(_channel, sett.rtc.getUnixMs(), Value);
+
+    return _log.append(_channel | (BLACKBOX_BOOT_TIME << 8), millis(), Value);
+  }
+
+public:
+  _BlackBox() : _log(BLACKBOX_LABEL, BLACKBOX_SUBTYPE, BLACKBOX_MAGIC) {
+  }
+
+  bool Begin() {
+    if (!_log.Begin())
+      return false;
+
+    _Put(_BlackBoxKind::Boot, 0, 0);
+
+    return true;
+  }
+
+  bool IsReady() const {
+    return _log.IsReady();
+  }
+
+  void sample(uint8_t Source, float Value) {
+    if (std::isfinite(Value))
+      _Put(_BlackBoxKind::Sample, Source, Value);
+  }
+
+  void event(uint8_t Source, bool State) {
+    _Put(_BlackBoxKind::Event, Source, State ? 1 : 0);
+  }
+
+  bool flush() {
+    return _log.flush();
+  }
+
+  // пишется в окне persist, см. persist.add()
+  _Persistent &Persist() {
+    return _log;
+  }
+
+  size_t Records() const {
+    return _log.Records();
+  }
+
+  size_t Capacity() const {
+    return _log.Capacity();
+  }
+
+  void setSampleInterval(ulong Millis) {
+    _sampleMillis = max(Millis, 1ul);
+  }
+
+  // часов записи при текущем опросе: ёмкость раздела (размер - из таблицы разделов) без сектора под стирание
+  size_t Hours() const {
+    const size_t _capacity = _log.Capacity();
+    const size_t _usable   = (_capacity > _FlashLog::SECTOR_RECORDS) ? _capacity - _FlashLog::SECTOR_RECORDS : 0;
+
+    return _usable / (BLACKBOX_CHANNELS * 3600000ul / _sampleMillis + BLACKBOX_EVENTS_HOUR);
+  }
+
+  ulong Erases() const {
+    return _log.Erases();
+  }
+
+  ulong Fails() const {
+    return _log.Fails();
+  }
+
+  ulong Dropped() const {
+    return _log.Dropped();
+  }
+};
+
+_BlackBox blackbox;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "_common.h"
+
+#define BOOT_PROFILE_SIZE 16
+
+// Профиль старта: время от включения до каждой вехи, каждая веха пишется один раз
+class _BootProfile {
+private:
+  struct _Mark {
+    const char *Name;
+    ulong       Millis;
+  };
+
+  _Mark  _marks[BOOT_PROFILE_SIZE];
+  size_t _count = 0;
+
+public:
+  _BootProfile() {
+  }
+
+  void mark(const char *Name) {
+    if (Has(Name) || (_count >= BOOT_PROFILE_SIZE))
+      return;
+
+    _marks[_count++] = {Name, millis()};
+
+    debug.tprintf("boot: %s +%lu ms\n", Name, _marks[_count - 1].Millis);
+  }
+
+  bool Has(const char *Name) const {
+    for (size_t i = 0; i < _count; i++) {
+      if (strcmp(_marks[i].Name, Name) == 0)
+        return true;
+    }
+
+    return false;
+  }
+
+  void print(Print &Out) const {
+    ulong _prev = 0;
+
+    for (size_t i = 0; i < _count; i++) {
+      Out.printf("%s: +%lu ms (%lu ms)\n", _marks[i].Name, _marks[i].Millis, _marks[i].Millis - _prev);
+
+      _prev = _marks[i].Millis;
+    }
+  }
+};
+
+_BootProfile boot;
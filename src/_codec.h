@@ -0,0 +1,283 @@
+#pragma once
+
+#include "_common.h"
+#include "_series.h"
+
+// Сжатие рядов в духе Gorilla: время - delta-of-delta с префиксными корзинами, значения - XOR с предыдущим float
+// Худший случай на точку: время 5 + 64 бит, значение 2 + 5 + 6 + 32 бит
+#define CODEC_POINT_MAX_BYTES 15
+#define CODEC_HEADER_BYTES    12
+
+class _BitWriter {
+private:
+  uint8_t *_buffer   = nullptr;
+  size_t   _capacity = 0;
+  size_t   _bits     = 0;
+  bool     _overflow = false;
+
+public:
+  _BitWriter(uint8_t *Buffer, size_t Capacity) : _buffer(Buffer), _capacity(Capacity) {
+    if (_buffer && _capacity)
+      memset(_buffer, 0, _capacity);
+  }
+
+  void write(uint64_t Value, uint8_t Bits) {
+    if (_overflow || ((_bits + Bits + 7) / 8 > _capacity)) {
+      _overflow = true;
+      return;
+    }
+
+    while (Bits > 0) {
+      const uint8_t _free  = 8 - (_bits & 7);
+      const uint8_t _count = min(_free, Bits);
+      const uint8_t _chunk = (Value >> (Bits - _count)) & ((1u << _count) - 1);
+
+      _buffer[_bits >> 3] |= _chunk << (_free - _count);
+
+      _bits += _count;
+      Bits -= _count;
+    }
+  }
+
+  size_t bytes() const {
+    return (_bits + 7) / 8;
+  }
+
+  bool ok() const {
+    return !_overflow;
+  }
+};
+
+class _BitReader {
+private:
+  const uint8_t *_buffer = nullptr;
+  size_t         _bits   = 0;
+  size_t         _pos    = 0;
+  bool           _error  = false;
+
+public:
+  _BitReader(const uint8_t *Buffer, size_t Bytes) : _buffer(Buffer), _bits(Bytes * 8) {
+  }
+
+  uint64_t read(uint8_t Bits) {
+    if (_error || (_pos + Bits > _bits)) {
+      _error = true;
+      return 0;
+    }
+
+    uint64_t _result = 0;
+
+    while (Bits > 0) {
+      const uint8_t _left  = 8 - (_pos & 7);
+      const uint8_t _count = min(_left, Bits);
+      const uint8_t _chunk = (_buffer[_pos >> 3] >> (_left - _count)) & ((1u << _count) - 1);
+
+      _result = (_result << _count) | _chunk;
+
+      _pos += _count;
+      Bits -= _count;
+    }
+
+    return _result;
+  }
+
+  bool ok() const {
+    return !_error;
+  }
+};
+
+class _SeriesEncoder {
+private:
+  _BitWriter _writer;
+
+  size_t   _count     = 0;
+  uint64_t _prevTime  = 0;
+  int64_t  _prevDelta = 0;
+  uint32_t _prevBits  = 0;
+  uint8_t  _leading   = 0xFF;
+  uint8_t  _trailing  = 0;
+
+  static uint64_t _ZigZag(int64_t Value) {
+    return (static_cast<uint64_t>(Value) << 1) ^ static_cast<uint64_t>(Value >> 63);
+  }
+
+  void _PutTime(uint64_t Time) {
+    const int64_t _delta = static_cast<int64_t>(Time - _prevTime);
+    const int64_t _dod   = _delta - _prevDelta;
+    const uint64_t _zz   = _ZigZag(_dod);
+
+    if (_dod == 0)
+      _writer.write(0b0, 1);
+    else if (_zz < (1ull << 7))
+      _writer.write((0b10ull << 7) | _zz, 2 + 7);
+    else if (_zz < (1ull << 9))
+      _writer.write((0b110ull << 9) | _zz, 3 + 9);
+    else if (_zz < (1ull << 12))
+      _writer.write((0b1110ull << 12) | _zz, 4 + 12);
+    else if (_zz < (1ull << 20))
+      _writer.write((0b11110ull << 20) | _zz, 5 + 20);
+    else {
+      _writer.write(0b11111, 5);
+      _writer.write(_zz, 64);
+    }
+
+    _prevDelta = _delta;
+    _prevTime  = Time;
+  }
+
+  void _PutValue(float Value) {
+    uint32_t _bits;
+    memcpy(&_bits, &Value, sizeof(_bits));
+
+    const uint32_t _xor = _bits ^ _prevBits;
+
+    _prevBits = _bits;
+
+    if (_xor == 0) {
+      _writer.write(0b0, 1);
+      return;
+    }
+
+    uint8_t _lead  = min(__builtin_clz(_xor), 31);
+    uint8_t _trail = __builtin_ctz(_xor);
+
+    if ((_leading != 0xFF) && (_lead >= _leading) && (_trail >= _trailing)) {
+      _writer.write(0b10, 2);
+      _writer.write(_xor >> _trailing, 32 - _leading - _trailing);
+      return;
+    }
+
+    const uint8_t _length = 32 - _lead - _trail;
+
+    _writer.write(0b11, 2);
+    _writer.write(_lead, 5);
+    _writer.write(_length - 1, 5);
+    _writer.write(_xor >> _trail, _length);
+
+    _leading  = _lead;
+    _trailing = _trail;
+  }
+
+public:
+  _SeriesEncoder(uint8_t *Buffer, size_t Capacity) : _writer(Buffer, Capacity) {
+  }
+
+  static size_t maxBytes(size_t Points) {
+    return CODEC_HEADER_BYTES + Points * CODEC_POINT_MAX_BYTES;
+  }
+
+  bool put(uint64_t Time, float Value) {
+    if (_count == 0) {
+      _writer.write(Time, 64);
+
+      memcpy(&_prevBits, &Value, sizeof(_prevBits));
+      _writer.write(_prevBits, 32);
+
+      _prevTime = Time;
+    } else {
+      _PutTime(Time);
+      _PutValue(Value);
+    }
+
+    _count++;
+
+    return _writer.ok();
+  }
+
+  size_t put(const _SeriesBuffer &Data, size_t From, size_t Count) {
+    size_t _put = 0;
+
+    for (size_t i = From; (i < From + Count) && (i < Data.size()); i++) {
+      if (!put(Data.Time(i), Data.Value(i)))
+        break;
+
+      _put++;
+    }
+
+    return _put;
+  }
+
+  size_t count() const {
+    return _count;
+  }
+
+  size_t bytes() const {
+    return _writer.bytes();
+  }
+
+  bool ok() const {
+    return _writer.ok();
+  }
+};
+
+class _SeriesDecoder {
+private:
+  _BitReader _reader;
+
+  size_t   _count     = 0;
+  uint64_t _prevTime  = 0;
+  int64_t  _prevDelta = 0;
+  uint32_t _prevBits  = 0;
+  uint8_t  _leading   = 0;
+  uint8_t  _trailing  = 0;
+
+  static int64_t _UnZigZag(uint64_t Value) {
+    return static_cast<int64_t>(Value >> 1) ^ -static_cast<int64_t>(Value & 1);
+  }
+
+  uint64_t _GetTime() {
+    uint8_t _prefix = 0;
+
+    while ((_prefix < 5) && _reader.read(1))
+      _prefix++;
+
+    static const uint8_t _sizes[] = {0, 7, 9, 12, 20, 64};
+
+    const int64_t _dod = (_prefix == 0) ? 0 : _UnZigZag(_reader.read(_sizes[_prefix]));
+
+    _prevDelta += _dod;
+    _prevTime += _prevDelta;
+
+    return _prevTime;
+  }
+
+  float _GetValue() {
+    if (_reader.read(1)) {
+      if (_reader.read(1)) {
+        _leading = _reader.read(5);
+
+        const uint8_t _length = _reader.read(5) + 1;
+
+        _trailing = 32 - _leading - _length;
+      }
+
+      _prevBits ^= static_cast<uint32_t>(_reader.read(32 - _leading - _trailing)) << _trailing;
+    }
+
+    float _value;
+    memcpy(&_value, &_prevBits, sizeof(_value));
+
+    return _value;
+  }
+
+public:
+  _SeriesDecoder(const uint8_t *Buffer, size_t Bytes) : _reader(Buffer, Bytes) {
+  }
+
+  bool next(uint64_t &Time, float &Value) {
+    if (_count == 0) {
+      _prevTime = _reader.read(64);
+      _prevBits = _reader.read(32);
+
+      Time = _prevTime;
+      memcpy(&Value, &_prevBits, sizeof(Value));
+    } else {
+      Time  = _GetTime();
+      Value = _GetValue();
+    }
+
+    _count++;
+
+    return _reader.ok();
+  }
+};
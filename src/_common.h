@@ -141,7 +141,10 @@
 #define WIFI_CHECK_INTERVAL 1000ul * 60ul
 #define WEB_UPDATE_INTERVAL 1000ul
 
-#define READINGS_HISTORY_SIZE 300ul
+#define READINGS_HISTORY_SIZE     256ul
+#define READINGS_HISTORY_SIZE_MAX 2048ul
+#define READINGS_HISTORY_MINUTES  10ul
+#define READINGS_BATCH_CHUNK      32 // образцов за проход _Readings::putValues(), буфер на стеке
 
 #define HUMIDIFIER_HARDWARE_DELAY 1000ul
 
@@ -264,7 +267,9 @@
 
 using _callback = std::function<void()>;
 
-GyverDBFile     db(&LittleFS, "/green_house.db");
+#define DB_FILE_NAME "/green_house.db"
+
+GyverDBFile     db(&LittleFS, DB_FILE_NAME);
 SettingsGyverWS sett("🍄 GreenHouse", &db);
 
 sets::Logger logger(5000);
@@ -418,7 +423,18 @@ enum dbParams : size_t {
   MqttUser,
   MqttPassword,
 
-  MqttPublishDelay
+  MqttPublishDelay,
+
+  TemperaturePlotInEpsilon,
+  HumidityPlotInEpsilon,
+  CO2PlotInEpsilon,
+
+  TemperaturePlotOutEpsilon,
+  HumidityPlotOutEpsilon,
+  CO2PlotOutEpsilon,
+
+  PlotEpsilonAdaptive,
+  PlotPointsPerHour
 };
 
 const char *dbParamsName[] PROGMEM = {
@@ -559,7 +575,18 @@ const char *dbParamsName[] PROGMEM = {
     "MqttUser",
     "MqttPassword",
 
-    "MqttPublishDelay"};
+    "MqttPublishDelay",
+
+    "TemperaturePlotInEpsilon",
+    "HumidityPlotInEpsilon",
+    "CO2PlotInEpsilon",
+
+    "TemperaturePlotOutEpsilon",
+    "HumidityPlotOutEpsilon",
+    "CO2PlotOutEpsilon",
+
+    "PlotEpsilonAdaptive",
+    "PlotPointsPerHour"};
 
 class _UsingIniciator {
 protected:
@@ -575,6 +602,19 @@ private:
   }
 };
 
+struct _Sample {
+  uint64_t UnixMs = 0;
+  ulong    Millis = 0;
+  float    Value  = 0;
+};
+
+inline ulong UnixMsToMillis(uint64_t UnixMs) {
+  if ((UnixMs == 0) || !sett.rtc.synced())
+    return millis();
+
+  return millis() - static_cast<ulong>(sett.rtc.getUnixMs() - UnixMs);
+}
+
 inline void MillisToTimeStr(char _buffer[], ulong _millis, bool _24 = false, bool _ms = false) {
   ulong sec = _millis / 1000ul;
   ulong ms  = _millis % 1000ul;
@@ -1,92 +1,157 @@
 #pragma once
 
 #include "_common.h"
+#include "_persist.h"
 #include <Arduino.h>
+#include <rom/crc.h>
 
-#define STAT_RANGE_STEP  5
-#define STAT_RANGE_COUNT 100 / STAT_RANGE_STEP
-#define STAT_BUFFER_SIZE 10
-#define STAT_PREDICT_MIN 10000ul
-#define STAT_PREDICT_MAX 20000ul
+#define STAT_RANGE_STEP   5
+#define STAT_RANGE_COUNT  100 / STAT_RANGE_STEP
+#define STAT_BUFFER_SIZE  10
+#define STAT_PREDICT_MIN  10000ul
+#define STAT_PREDICT_MAX  20000ul
+#define STAT_FILE_MAGIC   0x31545344 // "DST1"
+#define STAT_FILE_VERSION 1
 
-class DeviceController : public _ClassType {
-private:
-  float efficiencyInc[STAT_RANGE_COUNT][STAT_BUFFER_SIZE] = {0};
-  float efficiencyDec[STAT_RANGE_COUNT][STAT_BUFFER_SIZE] = {0};
+// Всё, чему контроллер научился: кольца замеров по диапазонам и средние по ним
+struct _ControllerStat {
+  float efficiencyInc[STAT_RANGE_COUNT][STAT_BUFFER_SIZE] = {{0}};
+  float efficiencyDec[STAT_RANGE_COUNT][STAT_BUFFER_SIZE] = {{0}};
 
   float avgEfficiencyInc[STAT_RANGE_COUNT] = {0};
   float avgEfficiencyDec[STAT_RANGE_COUNT] = {0};
 
   uint8_t bufferIndexInc[STAT_RANGE_COUNT] = {0};
   uint8_t bufferIndexDec[STAT_RANGE_COUNT] = {0};
-  ulong   SaveMillis                       = 0;
-  ulong   SaveMillisInterval               = 30000;
+};
+
+// Файл статистики целиком, читается и пишется одним блоком; размеры в заголовке - чтобы не принять файл
+// от сборки с другими STAT_RANGE_COUNT / STAT_BUFFER_SIZE
+struct _ControllerStatFile {
+  uint32_t        Magic      = STAT_FILE_MAGIC;
+  uint16_t        Version    = STAT_FILE_VERSION;
+  uint8_t         RangeCount = STAT_RANGE_COUNT;
+  uint8_t         BufferSize = STAT_BUFFER_SIZE;
+  _ControllerStat Stat;
+  uint32_t        Crc = 0;
+
+  void seal() {
+    Crc = crc32_le(0, reinterpret_cast<const uint8_t *>(this), offsetof(_ControllerStatFile, Crc));
+  }
+
+  bool valid() const {
+    return (Magic == STAT_FILE_MAGIC) && (Version == STAT_FILE_VERSION) &&
+           (RangeCount == STAT_RANGE_COUNT) && (BufferSize == STAT_BUFFER_SIZE) &&
+           (Crc == crc32_le(0, reinterpret_cast<const uint8_t *>(this), offsetof(_ControllerStatFile, Crc)));
+  }
+};
+
+class DeviceController : public _ClassType, public _Persistent {
+private:
+  _ControllerStat stat;
+
+  // снимок для фоновой записи
+  _ControllerStatFile snapshot;
+
+  char file_name[50]   = "";
+  char tmp_name[54]    = "";
+  char legacy_name[50] = "";
 
   bool _IsLoaded = false;
 
   ulong _PredictMin = STAT_PREDICT_MIN;
   ulong _PredictMax = STAT_PREDICT_MAX;
 
-  void save() {
-    if (!_IsLoaded || !_FS_Initialized)
-      return;
-
-    char file_name[50];
-    snprintf(file_name, sizeof(file_name), "/%s_stat.csv", SubTypeName());
+  void makeFileName() {
+    snprintf(file_name, sizeof(file_name), "/%s_stat.bin", SubTypeName());
     toLowerCase(file_name);
 
-    File f = LittleFS.open(file_name, FILE_WRITE);
-    if (!f)
-      return;
+    snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", file_name);
 
-    for (int i = 0; i < STAT_RANGE_COUNT; i++) {
-      f.printf("%d;%.4f;%.4f\n",
-               i, avgEfficiencyInc[i], avgEfficiencyDec[i]);
-    }
-    f.close();
+    snprintf(legacy_name, sizeof(legacy_name), "/%s_stat.csv", SubTypeName());
+    toLowerCase(legacy_name);
   }
 
+  // вызывается из первого Tick(), не из конструктора; нет двоичного файла - разово читаем старый CSV
   void load() {
     if (_IsLoaded || !_FS_Initialized)
       return;
 
     _IsLoaded = true;
 
-    char file_name[50];
-    snprintf(file_name, sizeof(file_name), "/%s_stat.csv", SubTypeName());
-    toLowerCase(file_name);
+    // .tmp пишется целиком до удаления .bin: без .bin он полный, рядом с .bin - недописанный
+    if (LittleFS.exists(tmp_name)) {
+      if (LittleFS.exists(file_name))
+        LittleFS.remove(tmp_name);
+      else
+        LittleFS.rename(tmp_name, file_name);
+    }
 
+    // читаем сразу в snapshot: до загрузки он не занят, а на стеке 2 КБ ни к чему
     File f = LittleFS.open(file_name, FILE_READ);
+    if (f) {
+      bool ok = (f.read(reinterpret_cast<uint8_t *>(&snapshot), sizeof(snapshot)) == sizeof(snapshot)) && snapshot.valid();
+
+      f.close();
+
+      if (ok) {
+        stat = snapshot.Stat;
+
+        // CSV - только когда двоичный файл уже прочитан и проверен
+        if (LittleFS.exists(legacy_name))
+          LittleFS.remove(legacy_name);
+
+        debug.printf("Loaded %s\n", file_name);
+        return;
+      }
+
+      debug.printf("Invalid %s\n", file_name);
+    }
+
+    loadLegacy();
+  }
+
+  // "range;inc;dec" построчно, в буфер на стеке без String; старый формат хранил только средние
+  void loadLegacy() {
+    File f = LittleFS.open(legacy_name, FILE_READ);
     if (!f) {
-      debug.printf("Failed to open file %s for reading\n", file_name);
+      debug.printf("Failed to open file %s for reading\n", legacy_name);
       return;
     }
 
-    debug.printf("Loading statistics from %s\n", file_name);
+    char line[48];
+    int  loaded = 0;
 
     while (f.available()) {
-      String line = f.readStringUntil('\n');
-      int    sep1 = line.indexOf(';');
-      int    sep2 = line.indexOf(';', sep1 + 1);
-
-      if (sep1 != -1 && sep2 != -1) {
-        int range = line.substring(0, sep1).toInt();
-        if (range >= 0 && range < STAT_RANGE_COUNT) {
-          avgEfficiencyInc[range] = line.substring(sep1 + 1, sep2).toFloat();
-          avgEfficiencyDec[range] = line.substring(sep2 + 1).toFloat();
-
-          debug.printf("Loaded range %d: inc=%.4f, dec=%.4f\n",
-                       range, avgEfficiencyInc[range], avgEfficiencyDec[range]);
-        }
+      size_t length = f.readBytesUntil('\n', line, sizeof(line) - 1);
+      line[length]  = '\0';
+
+      int   range;
+      float inc;
+      float dec;
+
+      if ((sscanf(line, "%d;%f;%f", &range, &inc, &dec) == 3) && isValidRange(range)) {
+        // среднее - первым замером кольца, иначе первый же новый замер его вытеснит
+        stat.avgEfficiencyInc[range] = stat.efficiencyInc[range][0] = inc;
+        stat.avgEfficiencyDec[range] = stat.efficiencyDec[range][0] = dec;
+        stat.bufferIndexInc[range]   = (inc != 0) ? 1 : 0;
+        stat.bufferIndexDec[range]   = (dec != 0) ? 1 : 0;
+
+        loaded++;
       }
     }
     f.close();
+
+    // перепишется в двоичный файл в ближайшем окне persist, CSV удалится при следующей загрузке
+    markDirty();
+
+    debug.printf("Loaded %d ranges from %s\n", loaded, legacy_name);
   }
 
   void updateStatistics(int range, bool isIncrease, float efficiency) {
-    float   *effBuf = isIncrease ? efficiencyInc[range] : efficiencyDec[range];
-    uint8_t &idx    = isIncrease ? bufferIndexInc[range] : bufferIndexDec[range];
-    float   &avgEff = isIncrease ? avgEfficiencyInc[range] : avgEfficiencyDec[range];
+    float   *effBuf = isIncrease ? stat.efficiencyInc[range] : stat.efficiencyDec[range];
+    uint8_t &idx    = isIncrease ? stat.bufferIndexInc[range] : stat.bufferIndexDec[range];
+    float   &avgEff = isIncrease ? stat.avgEfficiencyInc[range] : stat.avgEfficiencyDec[range];
 
     effBuf[idx] = efficiency;
     idx         = (idx + 1) % STAT_BUFFER_SIZE;
@@ -100,25 +165,64 @@ private:
       }
     }
     avgEff = count > 0 ? sumEff / count : 0;
+
+    markDirty();
   }
 
-  bool isValidRange(int range) {
+  bool isValidRange(int range) const {
     return range >= 0 && range < STAT_RANGE_COUNT;
   }
 
 public:
   DeviceController() {
-    load();
+    makeFileName();
   }
 
-  DeviceController(_MainType MainType, _SubType SubType, ulong PredictMin = STAT_PREDICT_MIN, ulong PredictMax = STAT_PREDICT_MAX) : DeviceController() {
+  DeviceController(_MainType MainType, _SubType SubType, ulong PredictMin = STAT_PREDICT_MIN, ulong PredictMax = STAT_PREDICT_MAX) {
     setType(MainType, SubType);
     setPredictMin(PredictMin);
     setPredictMax(PredictMax);
+
+    makeFileName();
   }
 
   ~DeviceController() {
-    save();
+    if (_IsLoaded && _FS_Initialized && IsDirty() && !IsBusy() && Snapshot())
+      Flush();
+  }
+
+  bool Snapshot() override {
+    if (!_IsLoaded)
+      return false;
+
+    snapshot      = _ControllerStatFile();
+    snapshot.Stat = stat;
+    snapshot.seal();
+
+    return true;
+  }
+
+  // через .tmp: оборванная запись не портит прежний файл
+  bool Flush() override {
+    File f = LittleFS.open(tmp_name, FILE_WRITE);
+    if (!f)
+      return false;
+
+    bool ok = (written(f.write(reinterpret_cast<const uint8_t *>(&snapshot), sizeof(snapshot))) == sizeof(snapshot));
+    f.close();
+
+    if (!ok) {
+      LittleFS.remove(tmp_name);
+      return false;
+    }
+
+    LittleFS.remove(file_name);
+
+    return LittleFS.rename(tmp_name, file_name);
+  }
+
+  const char *PersistName() override {
+    return file_name;
   }
 
   void put(float ValueFrom, float ValueTo, ulong WorkMillis, bool Increased) {
@@ -146,7 +250,7 @@ public:
       return 0;
 
     bool  isIncrease = TargetValue > CurrentValue;
-    float efficiency = isIncrease ? avgEfficiencyInc[range] : avgEfficiencyDec[range];
+    float efficiency = isIncrease ? stat.avgEfficiencyInc[range] : stat.avgEfficiencyDec[range];
 
     float neededChange = fabsf(TargetValue - CurrentValue);
 
@@ -163,19 +267,15 @@ public:
     for (int i = 0; i < STAT_RANGE_COUNT; i++) {
       debug.printf("Диапазон %d%%: ↑ %.2f, ↓ %.2f\n",
                    i * STAT_RANGE_STEP,
-                   avgEfficiencyInc[i],
-                   avgEfficiencyDec[i]);
+                   stat.avgEfficiencyInc[i],
+                   stat.avgEfficiencyDec[i]);
     }
   }
 
+  // запись - через persist, только после изменения статистики
   void Tick() {
-    ulong currentTime = millis();
-    if (((SaveMillis == 0) || (currentTime - SaveMillis) > SaveMillisInterval) && _FS_Initialized) {
+    if (_FS_Initialized)
       load();
-      save();
-
-      SaveMillis = currentTime;
-    }
   }
 
   void setPredictMin(ulong Value) {
@@ -191,6 +291,10 @@ public:
     setPredictMax(Max);
   }
 
+  bool IsLoaded() const {
+    return _IsLoaded;
+  }
+
   ulong PredictMin() {
     return _PredictMin;
   }
@@ -2,6 +2,7 @@
 
 #include "_classtype.h"
 #include "_common.h"
+#include "_latency.h"
 #include <GyverTimer.h>
 
 class _DeviceList;
@@ -10,6 +11,7 @@ class _Device : public _UsingIniciator, public _ClassType, public _ClassOwner<_D
 public:
   using _OnActiveChanged = std::function<void(_Device &Device, bool IsActive)>;
   using _OnStateChanged  = std::function<void(_Device &Device, bool State)>;
+  using _OnTrace         = std::function<void(_Device &Device, const _Trace &Trace)>;
 
 private:
   GTimer _DurationTimer;
@@ -34,18 +36,34 @@ private:
   bool _IsActive = false;
   bool _State    = false;
 
+  _Trace _PendingTrace;
+
   _OnActiveChanged _on_active_changed = nullptr;
   _OnStateChanged  _on_state_changed  = nullptr;
+  _OnTrace         _on_trace          = nullptr;
 
   bool _PinState() {
     return digitalRead(_Pin);
   }
 
+  void _Traced() {
+    if (!_PendingTrace.IsValid)
+      return;
+
+    _PendingTrace.RelayMicros = micros();
+
+    if (_on_trace)
+      _on_trace(*this, _PendingTrace);
+
+    _PendingTrace.clear();
+  }
+
   void _TurnOn() {
     if (_PinState() == _Level)
       return;
 
     digitalWrite(_Pin, _Level);
+    _Traced();
     _delay(50);
 
     _StateChangeMillis = millis();
@@ -61,6 +79,7 @@ private:
       return;
 
     digitalWrite(_Pin, !_Level);
+    _Traced();
     _delay(50);
 
     _StateChangeMillis = millis();
@@ -248,10 +267,19 @@ public:
       _on_active_changed = cb;
   }
 
+  void setTrace(const _Trace &Trace) {
+    _PendingTrace = Trace;
+  }
+
   void OnStateChanged(_OnStateChanged cb) {
     if (cb)
       _on_state_changed = cb;
   }
+
+  void OnTrace(_OnTrace cb) {
+    if (cb)
+      _on_trace = cb;
+  }
 };
 
 class _DeviceList {
@@ -298,6 +326,27 @@ public:
     Humidifier.OnStateChanged(cb);
   }
 
+  void setTrace(const _Trace &Trace) {
+    FanMain.setTrace(Trace);
+    FanInner.setTrace(Trace);
+    Heater.setTrace(Trace);
+    Humidifier.setTrace(Trace);
+  }
+
+  void clearTrace() {
+    setTrace(_Trace());
+  }
+
+  void OnDeviceTrace(_Device::_OnTrace cb) {
+    if (!cb)
+      return;
+
+    FanMain.OnTrace(cb);
+    FanInner.OnTrace(cb);
+    Heater.OnTrace(cb);
+    Humidifier.OnTrace(cb);
+  }
+
   _Device *operator[](_SubType subType) {
     if (FanMain.SubTypeIs(subType))
       return &FanMain;
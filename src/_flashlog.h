@@ -0,0 +1,480 @@
+#pragma once
+
+#include "_common.h"
+#include "_persist.h"
+#include "_series.h"
+#include <esp_partition.h>
+#include <rom/crc.h>
+
+#define FLASH_LOG_LABEL   "history"
+#define FLASH_LOG_SUBTYPE 0x40
+#define FLASH_LOG_MAGIC   0x31474C46 // "FLG1"
+#define FLASH_LOG_PAGE    256        // страница программирования флеша
+#define FLASH_LOG_PENDING 64         // записей в RAM до окна persist; с половины - внеочередная запись
+
+// Запись долгой истории: 16 байт, страница флеша 256 байт делится на записи без остатка
+struct _FlashRecord {
+  uint64_t UnixMs  = 0;
+  float    Value   = 0;
+  uint16_t Channel = 0;
+  uint16_t Crc     = 0;
+
+  void seal() {
+    Crc = crc16_le(0, reinterpret_cast<const uint8_t *>(this), offsetof(_FlashRecord, Crc));
+  }
+
+  bool valid() const {
+    return Crc == crc16_le(0, reinterpret_cast<const uint8_t *>(this), offsetof(_FlashRecord, Crc));
+  }
+
+  // стёртый флеш - все единицы
+  bool empty() const {
+    return UnixMs == UINT64_MAX;
+  }
+};
+
+// Заголовок сектора занимает место первой записи
+struct _FlashSector {
+  uint32_t Magic    = FLASH_LOG_MAGIC;
+  uint32_t Sequence = 0;
+  uint32_t Reserved = 0;
+  uint32_t Crc      = 0;
+
+  void seal() {
+    Crc = crc32_le(0, reinterpret_cast<const uint8_t *>(this), offsetof(_FlashSector, Crc));
+  }
+
+  bool valid(uint32_t Expected = FLASH_LOG_MAGIC) const {
+    return (Magic == Expected) && (Crc == crc32_le(0, reinterpret_cast<const uint8_t *>(this), offsetof(_FlashSector, Crc)));
+  }
+};
+
+static_assert(sizeof(_FlashRecord) == 16, "_FlashRecord must stay page-aligned");
+static_assert(sizeof(_FlashSector) == sizeof(_FlashRecord), "_FlashSector must fill one record slot");
+
+// Кольцо секторов в отдельном разделе флеша, мимо LittleFS. append() в loop только копит записи в RAM,
+// на флеш их целыми страницами пишет задача persist (Flush), там же стирается самый старый сектор.
+// Чтение - обход отображённого в память раздела, только секторов, чьи метки попадают в запрошенный интервал
+class _FlashLog : public _Persistent {
+public:
+  static const size_t SECTOR_RECORDS = SPI_FLASH_SEC_SIZE / sizeof(_FlashRecord) - 1;
+
+private:
+  static const size_t PAGE_RECORDS   = FLASH_LOG_PAGE / sizeof(_FlashRecord);
+
+  const char *_label   = FLASH_LOG_LABEL;
+  uint8_t     _subType = FLASH_LOG_SUBTYPE;
+  uint32_t    _magic   = FLASH_LOG_MAGIC;
+
+  const esp_partition_t  *_partition = nullptr;
+  const uint8_t          *_mapped    = nullptr;
+  spi_flash_mmap_handle_t _handle    = 0;
+
+  // голова кольца - меняет только Flush() в задаче
+  size_t   _sectors  = 0;
+  size_t   _head     = 0;
+  size_t   _slot     = 0;
+  uint32_t _sequence = 0;
+  size_t   _records  = 0;
+  ulong    _erases   = 0;
+  ulong    _fails    = 0;
+  ulong    _dropped  = 0;
+
+  // голова на момент снимка: до неё loop читает флеш, пока задача дописывает следующую пачку
+  size_t   _readHead     = 0;
+  size_t   _readSlot     = 0;
+  uint32_t _readSequence = 0;
+
+  // loop копит в _pending; Snapshot() переносит в _batch, который пишет задача и до следующего снимка читает forEach()
+  _FlashRecord _pending[FLASH_LOG_PENDING];
+  size_t       _pendingCount = 0;
+  _FlashRecord _batch[FLASH_LOG_PENDING];
+  size_t       _batchCount = 0;
+
+  // первая и последняя метка записей сектора, секунды; First > Last - сектор пуст
+  struct _Span {
+    uint32_t First;
+    uint32_t Last;
+  };
+
+  _Span *_spans   = nullptr;
+  size_t _scanned = 0;
+
+  bool _held = false;
+
+  const _FlashSector *_Sector(size_t Sector) const {
+    return reinterpret_cast<const _FlashSector *>(_mapped + Sector * SPI_FLASH_SEC_SIZE);
+  }
+
+  const _FlashRecord *_Records(size_t Sector) const {
+    return reinterpret_cast<const _FlashRecord *>(_mapped + Sector * SPI_FLASH_SEC_SIZE) + 1;
+  }
+
+  // число занятых слотов сектора: до первого стёртого, битые записи считаются занятыми
+  size_t _Used(size_t Sector) const {
+    const _FlashRecord *_records = _Records(Sector);
+
+    size_t _lo = 0;
+    size_t _hi = SECTOR_RECORDS;
+
+    while (_lo < _hi) {
+      size_t _mid = (_lo + _hi) / 2;
+
+      if (_records[_mid].empty())
+        _hi = _mid;
+      else
+        _lo = _mid + 1;
+    }
+
+    return _lo;
+  }
+
+  void _SpanClear(size_t Sector) {
+    if (_spans)
+      _spans[Sector] = {UINT32_MAX, 0};
+  }
+
+  void _SpanPut(size_t Sector, uint64_t UnixMs) {
+    if (!_spans)
+      return;
+
+    const uint32_t _seconds = static_cast<uint32_t>(min(UnixMs / 1000ull, (uint64_t)UINT32_MAX - 1));
+
+    _spans[Sector].First = min(_spans[Sector].First, _seconds);
+    _spans[Sector].Last  = max(_spans[Sector].Last, _seconds);
+  }
+
+  // без индекса (не хватило памяти) обходим всё
+  bool _SpanHas(size_t Sector, uint64_t From, uint64_t To) const {
+    if (!_spans)
+      return true;
+
+    const _Span &_span = _spans[Sector];
+
+    return (_span.First <= _span.Last) &&
+           (static_cast<uint64_t>(_span.Last) * 1000ull + 999ull >= From) &&
+           (static_cast<uint64_t>(_span.First) * 1000ull < To);
+  }
+
+  bool _Open(size_t Sector, uint32_t Sequence) {
+    if (esp_partition_erase_range(_partition, Sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) != ESP_OK)
+      return false;
+
+    _erases++;
+
+    _SpanClear(Sector);
+
+    _FlashSector _header;
+    _header.Magic    = _magic;
+    _header.Sequence = Sequence;
+    _header.seal();
+
+    if (esp_partition_write(_partition, Sector * SPI_FLASH_SEC_SIZE, &_header, sizeof(_header)) != ESP_OK)
+      return false;
+
+    written(sizeof(_header));
+
+    _head     = Sector;
+    _sequence = Sequence;
+    _slot     = 0;
+
+    return true;
+  }
+
+  // сектор головы заполнен - открываем следующий, затирая самый старый
+  bool _Advance() {
+    if (_slot < SECTOR_RECORDS)
+      return true;
+
+    const size_t _next = (_head + 1) % _sectors;
+
+    if (_Sector(_next)->valid(_magic))
+      _records -= _Used(_next);
+
+    if (!_Open(_next, _sequence + 1)) {
+      _fails++;
+      return false;
+    }
+
+    return true;
+  }
+
+  bool _Write(const _FlashRecord *Records, size_t Count) {
+    const size_t _offset = _head * SPI_FLASH_SEC_SIZE + (_slot + 1) * sizeof(_FlashRecord);
+
+    _slot += Count;
+
+    if (esp_partition_write(_partition, _offset, Records, Count * sizeof(_FlashRecord)) != ESP_OK) {
+      _fails++;
+      return false;
+    }
+
+    written(Count * sizeof(_FlashRecord));
+
+    for (size_t i = 0; i < Count; i++)
+      _SpanPut(_head, Records[i].UnixMs);
+
+    _records += Count;
+
+    return true;
+  }
+
+  template <typename F>
+  static size_t _Scan(const _FlashRecord *Records, size_t Count, uint16_t Channel, uint64_t From, uint64_t To, F &Put) {
+    size_t _count = 0;
+
+    for (size_t i = 0; i < Count; i++) {
+      const _FlashRecord &_record = Records[i];
+
+      if ((_record.Channel != Channel) || (_record.UnixMs < From) || (_record.UnixMs >= To) || !_record.valid())
+        continue;
+
+      Put(_record);
+      _count++;
+    }
+
+    return _count;
+  }
+
+public:
+  _FlashLog(const char *Label = FLASH_LOG_LABEL, uint8_t SubType = FLASH_LOG_SUBTYPE, uint32_t Magic = FLASH_LOG_MAGIC)
+      : _label(Label), _subType(SubType), _magic(Magic) {
+  }
+
+  ~_FlashLog() {
+    if (_mapped)
+      spi_flash_munmap(_handle);
+
+    delete[] _spans;
+  }
+
+  // раздел _label из partitions.csv; без него журнал просто выключен
+  bool Begin() {
+    if (_mapped)
+      return true;
+
+    _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, static_cast<esp_partition_subtype_t>(_subType), _label);
+
+    if (!_partition) {
+      debug.tprintf("FlashLog(%s): no partition\n", _label);
+      return false;
+    }
+
+    _sectors = _partition->size / SPI_FLASH_SEC_SIZE;
+
+    const void *_pointer = nullptr;
+
+    if ((_sectors < 2) || (esp_partition_mmap(_partition, 0, _sectors * SPI_FLASH_SEC_SIZE, SPI_FLASH_MMAP_DATA, &_pointer, &_handle) != ESP_OK)) {
+      debug.tprintf("FlashLog(%s): mmap failed\n", _label);
+      return false;
+    }
+
+    _mapped = static_cast<const uint8_t *>(_pointer);
+    _spans  = new (std::nothrow) _Span[_sectors];
+
+    bool _found = false;
+
+    // единственный полный обход - при старте, дальше индекс ведёт Flush()
+    for (size_t i = 0; i < _sectors; i++) {
+      const _FlashSector *_header = _Sector(i);
+
+      _SpanClear(i);
+
+      if (!_header->valid(_magic))
+        continue;
+
+      const size_t        _used    = _Used(i);
+      const _FlashRecord *_records = _Records(i);
+
+      for (size_t j = 0; j < _used; j++) {
+        if (_records[j].valid())
+          _SpanPut(i, _records[j].UnixMs);
+      }
+
+      _records += _used;
+
+      if (!_found || (static_cast<int32_t>(_header->Sequence - _sequence) > 0)) {
+        _head     = i;
+        _sequence = _header->Sequence;
+        _found    = true;
+      }
+    }
+
+    if (_found)
+      _slot = _Used(_head);
+    else if (!_Open(0, 1))
+      return false;
+
+    _readHead     = _head;
+    _readSlot     = _slot;
+    _readSequence = _sequence;
+
+    debug.tprintf("FlashLog(%s): %u sectors, head %u, %u records\n", _label, (uint)_sectors, (uint)_head, (uint)_records);
+
+    return true;
+  }
+
+  bool IsReady() const {
+    return _mapped != nullptr;
+  }
+
+  // loop: запись в RAM; на флеш - в окне persist или раньше, если набралось полбуфера. Буфер полон, а задача
+  // ещё пишет прошлую пачку - запись теряется (Dropped)
+  bool append(uint16_t Channel, uint64_t UnixMs, float Value) {
+    if (!_mapped)
+      return false;
+
+    if (_pendingCount >= FLASH_LOG_PENDING) {
+      _dropped++;
+      return false;
+    }
+
+    _FlashRecord &_record = _pending[_pendingCount++];
+    _record.UnixMs        = UnixMs;
+    _record.Value         = Value;
+    _record.Channel       = Channel;
+    _record.seal();
+
+    if (_pendingCount >= FLASH_LOG_PENDING / 2)
+      persist.Request(*this);
+
+    return true;
+  }
+
+  // внеочередная запись накопленного: перед перезагрузкой - persist.Sync()
+  bool flush() {
+    return (_pendingCount < 1) || persist.Request(*this);
+  }
+
+  size_t Pending() const {
+    return _pendingCount;
+  }
+
+  // loop, задача свободна: голова для чтения и пачка на запись
+  bool Snapshot() override {
+    if (_held)
+      return false;
+
+    _readHead     = _head;
+    _readSlot     = _slot;
+    _readSequence = _sequence;
+
+    memcpy(_batch, _pending, _pendingCount * sizeof(_FlashRecord));
+
+    _batchCount   = _pendingCount;
+    _pendingCount = 0;
+
+    return true;
+  }
+
+  // задача: пачка страницами, не переходя границу страницы и сектора
+  bool Flush() override {
+    size_t _done = 0;
+
+    while (_done < _batchCount) {
+      if (!_Advance())
+        return false;
+
+      // слот 0 сектора занят заголовком, поэтому граница страницы - на (_slot + 1) кратном PAGE_RECORDS
+      const size_t _page  = PAGE_RECORDS - (_slot + 1) % PAGE_RECORDS;
+      const size_t _count = min(min(_page, SECTOR_RECORDS - _slot), _batchCount - _done);
+
+      if (!_Write(_batch + _done, _count))
+        return false;
+
+      _done += _count;
+    }
+
+    return true;
+  }
+
+  bool IsDirty() override {
+    return _pendingCount > 0;
+  }
+
+  const char *PersistName() override {
+    return _label;
+  }
+
+  // от старых к новым, без копирования: Put(const _FlashRecord &) для записей канала с From <= UnixMs < To.
+  // Флеш - до головы снимка, сектора вне интервала пропускаются по индексу; потом пачка в записи и накопленное.
+  // Сектор, который задача успела переоткрыть после снимка, новее снимка - его пропускаем по номеру
+  template <typename F>
+  size_t forEach(uint16_t Channel, uint64_t From, uint64_t To, F Put) {
+    if (!_mapped)
+      return 0;
+
+    size_t _count = 0;
+
+    _scanned = 0;
+
+    for (size_t k = 1; k <= _sectors; k++) {
+      const size_t        _sector = (_readHead + k) % _sectors;
+      const _FlashSector *_header = _Sector(_sector);
+
+      if (!_header->valid(_magic) || (static_cast<int32_t>(_header->Sequence - _readSequence) > 0) || !_SpanHas(_sector, From, To))
+        continue;
+
+      _scanned++;
+
+      _count += _Scan(_Records(_sector), (_sector == _readHead) ? _readSlot : _Used(_sector), Channel, From, To, Put);
+    }
+
+    _count += _Scan(_batch, _batchCount, Channel, From, To, Put);
+    _count += _Scan(_pending, _pendingCount, Channel, From, To, Put);
+
+    return _count;
+  }
+
+  // loop: пока держим, задача не пишет и не затирает сектора - несколько проходов forEach() видят одно и то же
+  void Hold() {
+    while (IsBusy())
+      delay(1);
+
+    _held = true;
+  }
+
+  void Release() {
+    _held = false;
+  }
+
+  // группировка по интервалам прямо по отображённому флешу, см. _SeriesView::aggregate
+  template <typename F>
+  size_t aggregate(uint16_t Channel, uint64_t From, uint64_t To, uint64_t Interval, F Put) {
+    if (Interval < 1)
+      return 0;
+
+    _SeriesGrouper<F> _grouper(Interval, Put);
+
+    forEach(Channel, From, To, [&_grouper](const _FlashRecord &Record) { _grouper.put(Record.UnixMs, Record.Value); });
+
+    return _grouper.finish();
+  }
+
+  size_t Records() const {
+    return _records + _pendingCount;
+  }
+
+  size_t Capacity() const {
+    return _sectors * SECTOR_RECORDS;
+  }
+
+  // секторов, обойдённых последним forEach()
+  size_t Scanned() const {
+    return _scanned;
+  }
+
+  ulong Erases() const {
+    return _erases;
+  }
+
+  ulong Fails() const {
+    return _fails;
+  }
+
+  ulong Dropped() const {
+    return _dropped;
+  }
+};
+
+_FlashLog flashlog;
@@ -3,6 +3,7 @@
 #include "_alerts.h"
 #include "_common.h"
 #include "_devices.h"
+#include "_latency.h"
 #include "_mqtt.h"
 #include "_sensors.h"
 #include "_syncs.h"
@@ -49,14 +50,19 @@ private:
   }
 
 public:
-  _SensorList Sensors;
-  _DeviceList Devices;
-  _AlertList  Alerts;
-  _Sync       Sync;
+  _SensorList  Sensors;
+  _DeviceList  Devices;
+  _AlertList   Alerts;
+  _Sync        Sync;
+  _LatencyList Latency;
 
   _GreenHouse(GyverDBFile *db = nullptr, SettingsGyverWS *sett = nullptr) {
     _db   = db;
     _sett = sett;
+
+    Devices.OnDeviceTrace([this](_Device &Device, const _Trace &Trace) {
+      Latency.put(Trace);
+    });
   }
 
   ~_GreenHouse() {
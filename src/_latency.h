@@ -0,0 +1,158 @@
+#pragma once
+
+#include "_classtype.h"
+#include "_common.h"
+
+#define LATENCY_BUCKET_COUNT 24
+
+struct _Trace {
+  _SubType SubType        = _SubType::Undefined;
+  ulong    SampleMicros   = 0;
+  ulong    DecisionMicros = 0;
+  ulong    RelayMicros    = 0;
+  bool     IsValid        = false;
+
+  void clear() {
+    SubType        = _SubType::Undefined;
+    SampleMicros   = 0;
+    DecisionMicros = 0;
+    RelayMicros    = 0;
+    IsValid        = false;
+  }
+};
+
+class _LatencyHistogram {
+private:
+  uint32_t _Buckets[LATENCY_BUCKET_COUNT] = {0};
+
+  uint32_t _Count = 0;
+  ulong    _Min   = 0;
+  ulong    _Max   = 0;
+  uint64_t _Sum   = 0;
+
+  static uint8_t _Bucket(ulong Micros) {
+    uint8_t _bucket = 0;
+
+    while ((Micros > 1) && (_bucket < LATENCY_BUCKET_COUNT - 1)) {
+      Micros >>= 1;
+      _bucket++;
+    }
+
+    return _bucket;
+  }
+
+public:
+  void put(ulong Micros) {
+    _Buckets[_Bucket(Micros)]++;
+
+    _Min = (_Count > 0) ? min(_Min, Micros) : Micros;
+    _Max = max(_Max, Micros);
+    _Sum += Micros;
+
+    _Count++;
+  }
+
+  void clear() {
+    memset(_Buckets, 0, sizeof(_Buckets));
+
+    _Count = 0;
+    _Min   = 0;
+    _Max   = 0;
+    _Sum   = 0;
+  }
+
+  uint32_t Count() {
+    return _Count;
+  }
+
+  ulong Min() {
+    return _Min;
+  }
+
+  ulong Max() {
+    return _Max;
+  }
+
+  ulong Avg() {
+    return (_Count > 0) ? static_cast<ulong>(_Sum / _Count) : 0;
+  }
+
+  ulong Percentile(float Percent) {
+    if (_Count < 1)
+      return 0;
+
+    uint32_t _target = static_cast<uint32_t>(ceilf(_Count * constrain(Percent, 0.0f, 100.0f) / 100.0f));
+    uint32_t _passed = 0;
+
+    for (uint8_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+      _passed += _Buckets[i];
+
+      if (_passed >= _target)
+        return min(_Max, (2ul << i) - 1);
+    }
+
+    return _Max;
+  }
+};
+
+class _Latency : public _ClassType {
+public:
+  _LatencyHistogram SampleToDecision;
+  _LatencyHistogram DecisionToRelay;
+  _LatencyHistogram SampleToRelay;
+
+  _Latency() {
+  }
+
+  void put(const _Trace &Trace) {
+    if (!Trace.IsValid || (Trace.SampleMicros == 0))
+      return;
+
+    SampleToDecision.put(Trace.DecisionMicros - Trace.SampleMicros);
+    DecisionToRelay.put(Trace.RelayMicros - Trace.DecisionMicros);
+    SampleToRelay.put(Trace.RelayMicros - Trace.SampleMicros);
+  }
+
+  void clear() {
+    SampleToDecision.clear();
+    DecisionToRelay.clear();
+    SampleToRelay.clear();
+  }
+};
+
+class _LatencyList {
+public:
+  _Latency Temperature;
+  _Latency Humidity;
+  _Latency CO2;
+
+  _LatencyList() {
+    Temperature.setType(_MainType::Alert, _SubType::Temperature);
+    Humidity.setType(_MainType::Alert, _SubType::Humidity);
+    CO2.setType(_MainType::Alert, _SubType::CO2);
+  }
+
+  _Latency *operator[](_SubType subType) {
+    if (Temperature.SubTypeIs(subType))
+      return &Temperature;
+    if (Humidity.SubTypeIs(subType))
+      return &Humidity;
+    if (CO2.SubTypeIs(subType))
+      return &CO2;
+
+    return nullptr;
+  }
+
+  void put(const _Trace &Trace) {
+    _Latency *_latency = (*this)[Trace.SubType];
+
+    if (_latency)
+      _latency->put(Trace);
+  }
+
+  void clear() {
+    Temperature.clear();
+    Humidity.clear();
+    CO2.clear();
+  }
+};
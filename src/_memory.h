@@ -0,0 +1,33 @@
+#pragma once
+
+#include "_common.h"
+
+#define PSRAM_HISTORY_FACTOR 10 // во сколько раз больше истории держим при наличии PSRAM
+
+// Большие буферы данных: в PSRAM, если она есть, чтобы внутренняя DRAM оставалась WiFi и LWIP.
+// Только для тривиальных типов - конструкторы не вызываются; освобождать через psramFree()
+template <typename T>
+T *psramAlloc(size_t Count) {
+  if (Count < 1)
+    return nullptr;
+
+  void *_ptr = nullptr;
+
+  if (psramFound())
+    _ptr = heap_caps_malloc(Count * sizeof(T), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+
+  if (!_ptr)
+    _ptr = heap_caps_malloc(Count * sizeof(T), MALLOC_CAP_8BIT);
+
+  return static_cast<T *>(_ptr);
+}
+
+inline void psramFree(void *Ptr) {
+  if (Ptr)
+    heap_caps_free(Ptr);
+}
+
+// множитель для лимитов истории: на платах с PSRAM (WROVER) память позволяет хранить больше
+inline size_t historyScale() {
+  return psramFound() ? PSRAM_HISTORY_FACTOR : 1;
+}
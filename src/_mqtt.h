@@ -318,6 +318,35 @@ public:
     _PubSubClient.publish(_topic, value);
   }
 
+  // бинарная нагрузка потоком, без увеличения буфера PubSubClient
+  void Publish(const char *topic, const uint8_t *payload, const size_t length) {
+    if (!BeginPublish(topic, length))
+      return;
+
+    Write(payload, length);
+    EndPublish();
+  }
+
+  // длина известна заранее, нагрузка дописывается частями через Write()
+  bool BeginPublish(const char *topic, const size_t length) {
+    if (!_PubSubClient.connected())
+      return false;
+
+    char _topic[50];
+
+    makeTopic(_topic, sizeof(_topic), topic);
+
+    return _PubSubClient.beginPublish(_topic, length, false);
+  }
+
+  size_t Write(const uint8_t *payload, const size_t length) {
+    return _PubSubClient.write(payload, length);
+  }
+
+  bool EndPublish() {
+    return _PubSubClient.endPublish();
+  }
+
   void Publish(const char *topic, const double value) {
     char _value[10] = "";
     snprintf(_value, sizeof(_value), "%.1f", value);
@@ -0,0 +1,377 @@
+#pragma once
+
+#include "_common.h"
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#define PERSIST_ITEMS_MAX     12
+#define PERSIST_QUEUE_SIZE    PERSIST_ITEMS_MAX // каждый объект в очереди не больше раза (_busy)
+#define PERSIST_TASK_STACK    4096
+#define PERSIST_TASK_PRIORITY 1
+#define PERSIST_TASK_CORE     0
+#define PERSIST_WINDOW        60000ul // изменённое копится и пишется одной пачкой раз в окно
+
+// Tick() ставит в очередь все изменённые объекты разом, без ожидания
+static_assert(PERSIST_QUEUE_SIZE >= PERSIST_ITEMS_MAX, "persist queue must hold every registered item");
+
+#define DB_BACKUP_NAMESPACE "greenhouse"
+#define DB_BACKUP_KEY       "db"
+#define DB_BACKUP_MAX       8192 // байт; больше - копия в NVS не делается
+
+struct _FlushStat {
+  ulong    Count      = 0;
+  ulong    Fails      = 0;
+  ulong    LastMicros = 0;
+  ulong    MaxMicros  = 0;
+  uint64_t SumMicros  = 0;
+  uint64_t Bytes      = 0;
+
+  void put(ulong Micros, bool Ok, size_t Written) {
+    Count++;
+
+    if (!Ok)
+      Fails++;
+
+    Bytes += Written;
+
+    LastMicros = Micros;
+    MaxMicros  = max(MaxMicros, Micros);
+    SumMicros += Micros;
+  }
+
+  ulong AvgMicros() const {
+    return (Count > 0) ? static_cast<ulong>(SumMicros / Count) : 0;
+  }
+};
+
+// Объект, который пишется фоном: Snapshot() - в loop, копия в задний буфер; Flush() - в задаче, задний буфер в LittleFS
+class _Persistent {
+  friend class _PersistWorker;
+
+private:
+  volatile bool _busy    = false;
+  bool          _dirty   = false;
+  size_t        _written = 0;
+
+protected:
+  // Flush() отчитывается о записанных байтах - по ним считается износ флеша
+  size_t written(size_t Bytes) {
+    _written += Bytes;
+
+    return Bytes;
+  }
+
+public:
+  _FlushStat FlushStat;
+
+  virtual ~_Persistent() {
+  }
+
+  virtual bool Snapshot() = 0;
+  virtual bool Flush()    = 0;
+
+  virtual const char *PersistName() = 0;
+
+  // есть что писать; по умолчанию - флаг markDirty(), сбрасывается удачным Snapshot()
+  virtual bool IsDirty() {
+    return _dirty;
+  }
+
+  // true - Flush() только из loop, не из задачи
+  virtual bool InLoop() const {
+    return false;
+  }
+
+  void markDirty() {
+    _dirty = true;
+  }
+
+  bool IsBusy() const {
+    return _busy;
+  }
+};
+
+// Планировщик записи: объекты регистрируются через add(), Tick() раз в окно собирает все изменённые
+// и отдаёт их задаче одной пачкой; неизменённые не пишутся вовсе
+class _PersistWorker {
+private:
+  QueueHandle_t _queue = nullptr;
+  TaskHandle_t  _task  = nullptr;
+
+  _Persistent *_items[PERSIST_ITEMS_MAX];
+  size_t       _count = 0;
+
+  ulong _window       = PERSIST_WINDOW;
+  ulong _windowMillis = 0;
+  ulong _startMillis  = 0;
+
+  static void _Flush(_Persistent *Item) {
+    Item->_written = 0;
+
+    ulong _micros = micros();
+    bool  _ok     = Item->Flush();
+
+    Item->FlushStat.put(micros() - _micros, _ok, Item->_written);
+    Item->_busy = false;
+  }
+
+  static void _Task(void *Param) {
+    _PersistWorker *_worker = static_cast<_PersistWorker *>(Param);
+    _Persistent    *_item   = nullptr;
+
+    for (;;) {
+      if (xQueueReceive(_worker->_queue, &_item, portMAX_DELAY) == pdTRUE)
+        _Flush(_item);
+    }
+  }
+
+public:
+  _PersistWorker() {
+  }
+
+  bool Begin() {
+    _startMillis  = millis();
+    _windowMillis = millis();
+
+    if (_task)
+      return true;
+
+    _queue = xQueueCreate(PERSIST_QUEUE_SIZE, sizeof(_Persistent *));
+
+    if (!_queue)
+      return false;
+
+    if (xTaskCreatePinnedToCore(_Task, "persist", PERSIST_TASK_STACK, this, PERSIST_TASK_PRIORITY, &_task, PERSIST_TASK_CORE) != pdPASS) {
+      _task = nullptr;
+
+      debug.tprintln("Persist task failed");
+      return false;
+    }
+
+    return true;
+  }
+
+  bool add(_Persistent &Item) {
+    for (size_t i = 0; i < _count; i++) {
+      if (_items[i] == &Item)
+        return true;
+    }
+
+    if (_count >= PERSIST_ITEMS_MAX)
+      return false;
+
+    _items[_count++] = &Item;
+
+    return true;
+  }
+
+  // loop: снимок и постановка в очередь; без задачи пишет сразу
+  bool Request(_Persistent &Item) {
+    if (Item._busy || !Item.Snapshot())
+      return false;
+
+    Item._busy = true;
+
+    _Persistent *_item = &Item;
+
+    // снимок уже забрал данные у объекта: не встал в очередь - пишем сразу, иначе они потеряны
+    if (_task && !Item.InLoop() && (xQueueSend(_queue, &_item, 0) == pdTRUE)) {
+      Item._dirty = false;
+      return true;
+    }
+
+    Item._dirty = false;
+
+    _Flush(&Item);
+
+    return true;
+  }
+
+  // loop: окно закрылось - пишем всё изменённое разом
+  void Tick() {
+    if ((millis() - _windowMillis) < _window)
+      return;
+
+    _windowMillis = millis();
+
+    for (size_t i = 0; i < _count; i++) {
+      if (_items[i]->IsDirty())
+        Request(*_items[i]);
+    }
+  }
+
+  // перед перезагрузкой: дожидаемся задачи и дописываем изменённое прямо из loop
+  void Sync() {
+    for (size_t i = 0; i < _count; i++) {
+      _Persistent *_item = _items[i];
+
+      while (_item->_busy)
+        delay(10);
+
+      if (_item->IsDirty() && _item->Snapshot()) {
+        _item->_dirty = false;
+        _item->_busy  = true;
+
+        _Flush(_item);
+      }
+    }
+  }
+
+  void setWindow(ulong Millis) {
+    _window = Millis;
+  }
+
+  ulong Window() const {
+    return _window;
+  }
+
+  size_t Count() const {
+    return _count;
+  }
+
+  _Persistent &Item(size_t i) {
+    return *_items[i];
+  }
+
+  uint64_t Bytes() const {
+    uint64_t _bytes = 0;
+
+    for (size_t i = 0; i < _count; i++)
+      _bytes += _items[i]->FlushStat.Bytes;
+
+    return _bytes;
+  }
+
+  // средняя запись на флеш с Begin(), байт в час
+  uint64_t BytesPerHour() const {
+    const ulong _elapsed = millis() - _startMillis;
+
+    return (_elapsed > 0) ? Bytes() * 3600000ull / _elapsed : 0;
+  }
+
+  bool IsRunning() const {
+    return _task != nullptr;
+  }
+};
+
+// Настройки GyverDBFile: библиотека не потокобезопасна, поэтому пишется из loop, но в общем окне.
+// Копия файла лежит в NVS: LittleFS форматируется при смене partitions.csv, NVS - нет
+class _SettingsPersist : public _Persistent {
+private:
+  static uint8_t *_Buffer(size_t Size) {
+    if ((Size < 1) || (Size > DB_BACKUP_MAX))
+      return nullptr;
+
+    return new (std::nothrow) uint8_t[Size];
+  }
+
+public:
+  _SettingsPersist() {
+  }
+
+  bool Backup() {
+    File f = LittleFS.open(DB_FILE_NAME, FILE_READ);
+
+    if (!f)
+      return false;
+
+    const size_t _size   = f.size();
+    uint8_t     *_buffer = _Buffer(_size);
+
+    bool _result = _buffer && (f.read(_buffer, _size) == _size);
+
+    f.close();
+
+    if (_result) {
+      Preferences _prefs;
+
+      _result = _prefs.begin(DB_BACKUP_NAMESPACE, false) && (_prefs.putBytes(DB_BACKUP_KEY, _buffer, _size) == _size);
+
+      _prefs.end();
+    }
+
+    delete[] _buffer;
+
+    return _result;
+  }
+
+  bool HasBackup() {
+    Preferences _prefs;
+
+    if (!_prefs.begin(DB_BACKUP_NAMESPACE, true))
+      return false;
+
+    const bool _result = _prefs.getBytesLength(DB_BACKUP_KEY) > 0;
+
+    _prefs.end();
+
+    return _result;
+  }
+
+  // LittleFS только что отформатирован: файл настроек - из копии в NVS, до db.begin()
+  bool Restore() {
+    Preferences _prefs;
+
+    if (!_prefs.begin(DB_BACKUP_NAMESPACE, true))
+      return false;
+
+    const size_t _size   = _prefs.getBytesLength(DB_BACKUP_KEY);
+    uint8_t     *_buffer = _Buffer(_size);
+
+    bool _result = _buffer && (_prefs.getBytes(DB_BACKUP_KEY, _buffer, _size) == _size);
+
+    _prefs.end();
+
+    if (_result) {
+      File f = LittleFS.open(DB_FILE_NAME, FILE_WRITE);
+
+      _result = f && (f.write(_buffer, _size) == _size);
+
+      if (f)
+        f.close();
+    }
+
+    delete[] _buffer;
+
+    debug.tprintf("Settings restore(%u) = %d\n", (uint)_size, _result);
+
+    return _result;
+  }
+
+  bool Snapshot() override {
+    return true;
+  }
+
+  bool Flush() override {
+    if (!db.update())
+      return false;
+
+    File f = LittleFS.open(DB_FILE_NAME, FILE_READ);
+
+    if (f) {
+      written(f.size());
+      f.close();
+    }
+
+    Backup();
+
+    return true;
+  }
+
+  bool IsDirty() override {
+    return db.changed();
+  }
+
+  bool InLoop() const override {
+    return true;
+  }
+
+  const char *PersistName() override {
+    return DB_FILE_NAME;
+  }
+};
+
+_PersistWorker   persist;
+_SettingsPersist settingsPersist;
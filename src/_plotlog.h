@@ -0,0 +1,434 @@
+#pragma once
+
+#include "_codec.h"
+#include "_common.h"
+#include "_series.h"
+#include <rom/crc.h>
+
+#define PLOT_LOG_PENDING     32
+#define PLOT_LOG_MAX_RECORDS 256
+#define PLOT_LOG_MAGIC       0x31534C50 // "PLS1" - сегмент из записей _PlotRecord
+#define PLOT_LOG_MAGIC_V2    0x32534C50 // "PLS2" - сегмент из сжатых блоков _PlotBlockHeader + поток _SeriesEncoder
+#define PLOT_LOG_BLOCK       64
+#define PLOT_LOG_BASE_MAX    40 // имя без расширения, с завершающим нулём
+
+// Запись лога: время, значение и CRC32 первых 12 байт
+struct _PlotRecord {
+  uint64_t UnixMs = 0;
+  float    Value  = 0;
+  uint32_t Crc    = 0;
+
+  void seal() {
+    Crc = crc32_le(0, reinterpret_cast<const uint8_t *>(this), offsetof(_PlotRecord, Crc));
+  }
+
+  bool valid() const {
+    return Crc == crc32_le(0, reinterpret_cast<const uint8_t *>(this), offsetof(_PlotRecord, Crc));
+  }
+};
+
+struct _PlotSegmentHeader {
+  uint32_t Magic = PLOT_LOG_MAGIC_V2;
+  uint32_t Count = 0;
+};
+
+struct _PlotBlockHeader {
+  uint16_t Count = 0;
+  uint16_t Bytes = 0;
+  uint32_t Crc   = 0;
+};
+
+// Append-only лог точек графика:
+//   <base>.seg - запечатанный сегмент (заголовок + сжатые блоки), пишется через .tmp и rename
+//   <base>.log - новые архивные точки, дописываются пачками
+class _PlotLog {
+private:
+  // + ".seg" / ".log" / ".tmp": имена не обрезаются и не совпадают
+  char _segName[PLOT_LOG_BASE_MAX + 4] = "";
+  char _logName[PLOT_LOG_BASE_MAX + 4] = "";
+  char _tmpName[PLOT_LOG_BASE_MAX + 4] = "";
+
+  // передний буфер пополняет loop, задний пишет фоновая задача
+  _PlotRecord _pending[2][PLOT_LOG_PENDING];
+  size_t      _pendingCount[2] = {0, 0};
+  uint8_t     _front           = 0;
+
+  size_t        _logRecords = 0;
+  bool          _compact    = false;
+  volatile bool _failed     = false;
+  size_t        _written    = 0;
+
+  _SeriesBuffer _snapshot;
+  size_t        _snapshotCount   = 0;
+  bool          _snapshotCompact = false;
+
+  enum class _RecoverStage : uint8_t {
+    Segment,
+    Log,
+    Done
+  };
+
+  File          _recoverFile;
+  _RecoverStage _recoverStage = _RecoverStage::Done;
+  size_t        _recoverLeft  = 0;
+  bool          _recoverV2    = false;
+
+  void _OpenLog() {
+    if (_recoverFile)
+      _recoverFile.close();
+
+    _recoverStage = _RecoverStage::Done;
+
+    if (!LittleFS.exists(_logName))
+      return;
+
+    _recoverFile = LittleFS.open(_logName, FILE_READ);
+
+    if (_recoverFile)
+      _recoverStage = _RecoverStage::Log;
+  }
+
+  static size_t _ReadRecords(File &f, size_t Limit, std::function<void(uint64_t, float)> put) {
+    _PlotRecord _record;
+    size_t      _count = 0;
+
+    while ((_count < Limit) && (f.read(reinterpret_cast<uint8_t *>(&_record), sizeof(_record)) == sizeof(_record))) {
+      if (!_record.valid())
+        break;
+
+      put(_record.UnixMs, _record.Value);
+      _count++;
+    }
+
+    return _count;
+  }
+
+  // блоки декодируются независимо, читаем до первого битого
+  static size_t _ReadBlocks(File &f, size_t Limit, std::function<void(uint64_t, float)> put) {
+    uint8_t *_buffer = new (std::nothrow) uint8_t[_SeriesEncoder::maxBytes(PLOT_LOG_BLOCK)];
+
+    if (!_buffer)
+      return 0;
+
+    _PlotBlockHeader _block;
+    size_t           _count = 0;
+
+    while ((_count < Limit) && (f.read(reinterpret_cast<uint8_t *>(&_block), sizeof(_block)) == sizeof(_block))) {
+      if ((_block.Count > PLOT_LOG_BLOCK) || (_block.Bytes > _SeriesEncoder::maxBytes(PLOT_LOG_BLOCK)))
+        break;
+
+      if ((f.read(_buffer, _block.Bytes) != _block.Bytes) || (crc32_le(0, _buffer, _block.Bytes) != _block.Crc))
+        break;
+
+      _SeriesDecoder _decoder(_buffer, _block.Bytes);
+
+      uint64_t _time;
+      float    _value;
+
+      for (size_t i = 0; i < _block.Count; i++) {
+        if (!_decoder.next(_time, _value))
+          break;
+
+        put(_time, _value);
+        _count++;
+      }
+    }
+
+    delete[] _buffer;
+
+    return _count;
+  }
+
+public:
+  _PlotLog() {
+  }
+
+  // слишком длинное имя - лог выключен (имена пустые)
+  void setName(const char *Base) {
+    *_segName = *_logName = *_tmpName = '\0';
+
+    if (!Base || (strlen(Base) >= PLOT_LOG_BASE_MAX)) {
+      debug.tprintf("PlotLog: name too long\n");
+      return;
+    }
+
+    snprintf(_segName, sizeof(_segName), "%s.seg", Base);
+    snprintf(_logName, sizeof(_logName), "%s.log", Base);
+    snprintf(_tmpName, sizeof(_tmpName), "%s.tmp", Base);
+  }
+
+  // переполнение не теряет точки: они уже в памяти и попадут в следующий сегмент
+  void append(uint64_t UnixMs, float Value) {
+    if (_pendingCount[_front] >= PLOT_LOG_PENDING) {
+      _compact = true;
+      return;
+    }
+
+    _PlotRecord &_record = _pending[_front][_pendingCount[_front]++];
+
+    _record.UnixMs = UnixMs;
+    _record.Value  = Value;
+    _record.seal();
+  }
+
+  // история переписана (RDP, обрезка) - лог больше не соответствует данным, нужна компактификация
+  void invalidate() {
+    _pendingCount[_front] = 0;
+    _compact              = true;
+  }
+
+  bool SnapshotCompact() const {
+    return _snapshotCompact;
+  }
+
+  // есть новые точки или история переписана
+  bool IsDirty() const {
+    return (_pendingCount[_front] > 0) || NeedCompact();
+  }
+
+  // байт записано Flush() с прошлого вызова
+  size_t TakeWritten() {
+    size_t _result = _written;
+
+    _written = 0;
+
+    return _result;
+  }
+
+  bool NeedCompact() const {
+    return _compact || _failed || (_logRecords + _pendingCount[_front] >= PLOT_LOG_MAX_RECORDS);
+  }
+
+  // loop: либо копия всей истории под компактификацию, либо обмен буферов новых записей
+  bool Snapshot(const _SeriesBuffer &Data, size_t Count) {
+    if (NeedCompact()) {
+      if (!_snapshot.assign(Data))
+        return false;
+
+      _snapshotCount   = min(Count, _snapshot.size());
+      _snapshotCompact = true;
+
+      _pendingCount[_front] = 0;
+      _logRecords           = 0;
+      _compact              = false;
+      _failed               = false;
+
+      return true;
+    }
+
+    if (_pendingCount[_front] < 1)
+      return false;
+
+    _logRecords += _pendingCount[_front];
+    _snapshotCompact = false;
+
+    _front ^= 1;
+    _pendingCount[_front] = 0;
+
+    return true;
+  }
+
+  // фоновая задача: пишет то, что подготовил Snapshot()
+  bool Flush() {
+    bool _ok = false;
+
+    if (_snapshotCompact) {
+      _ok = Compact(_snapshot, _snapshotCount);
+
+      _snapshot.setCapacity(0);
+    } else {
+      _ok = Append(_pending[_front ^ 1], _pendingCount[_front ^ 1]);
+    }
+
+    if (!_ok)
+      _failed = true;
+
+    return _ok;
+  }
+
+  bool Append(const _PlotRecord *Records, size_t Count) {
+    if (!_FS_Initialized || !*_logName)
+      return false;
+
+    if (Count < 1)
+      return true;
+
+    File f = LittleFS.open(_logName, FILE_APPEND);
+    if (!f)
+      return false;
+
+    size_t _bytes = Count * sizeof(_PlotRecord);
+    bool   _ok    = (f.write(reinterpret_cast<const uint8_t *>(Records), _bytes) == _bytes);
+
+    f.close();
+
+    _written += _bytes;
+
+    return _ok;
+  }
+
+  // запечатывает всю историю в новый сегмент и сбрасывает лог
+  bool Compact(const _SeriesBuffer &Data, size_t Count) {
+    if (!_FS_Initialized || !*_segName)
+      return false;
+
+    File f = LittleFS.open(_tmpName, FILE_WRITE);
+    if (!f)
+      return false;
+
+    const size_t _capacity = _SeriesEncoder::maxBytes(PLOT_LOG_BLOCK);
+    uint8_t     *_buffer   = new (std::nothrow) uint8_t[_capacity];
+
+    if (!_buffer) {
+      f.close();
+      return false;
+    }
+
+    _PlotSegmentHeader _header;
+    _header.Count = Count;
+
+    bool _ok = (f.write(reinterpret_cast<const uint8_t *>(&_header), sizeof(_header)) == sizeof(_header));
+
+    _written += sizeof(_header);
+
+    for (size_t from = 0; _ok && (from < Count); from += PLOT_LOG_BLOCK) {
+      _SeriesEncoder _encoder(_buffer, _capacity);
+
+      _PlotBlockHeader _block;
+      _block.Count = _encoder.put(Data, from, min((size_t)PLOT_LOG_BLOCK, Count - from));
+      _block.Bytes = _encoder.bytes();
+      _block.Crc   = crc32_le(0, _buffer, _block.Bytes);
+
+      _ok = _encoder.ok() &&
+            (f.write(reinterpret_cast<const uint8_t *>(&_block), sizeof(_block)) == sizeof(_block)) &&
+            (f.write(_buffer, _block.Bytes) == _block.Bytes);
+
+      _written += sizeof(_block) + _block.Bytes;
+    }
+
+    delete[] _buffer;
+
+    f.close();
+
+    if (!_ok) {
+      LittleFS.remove(_tmpName);
+      return false;
+    }
+
+    LittleFS.remove(_segName);
+
+    if (!LittleFS.rename(_tmpName, _segName))
+      return false;
+
+    LittleFS.remove(_logName);
+
+    return true;
+  }
+
+  // пошаговое восстановление: BeginRecover() открывает файлы, RecoverStep() читает около Limit точек за вызов
+  // (сегмент - целыми блоками), false - всё прочитано. Что-то отброшено - следующая запись будет компактификацией
+  bool BeginRecover() {
+    EndRecover();
+
+    if (!_FS_Initialized || !*_segName)
+      return false;
+
+    // .tmp пишется целиком до удаления .seg: без .seg он полный, рядом с .seg - недописанный
+    if (LittleFS.exists(_tmpName)) {
+      if (LittleFS.exists(_segName))
+        LittleFS.remove(_tmpName);
+      else
+        LittleFS.rename(_tmpName, _segName);
+    }
+
+    _logRecords   = 0;
+    _recoverStage = _RecoverStage::Segment;
+
+    if (LittleFS.exists(_segName)) {
+      _recoverFile = LittleFS.open(_segName, FILE_READ);
+
+      _PlotSegmentHeader _header;
+
+      if (_recoverFile && (_recoverFile.read(reinterpret_cast<uint8_t *>(&_header), sizeof(_header)) == sizeof(_header)) &&
+          ((_header.Magic == PLOT_LOG_MAGIC) || (_header.Magic == PLOT_LOG_MAGIC_V2))) {
+        _recoverV2   = (_header.Magic == PLOT_LOG_MAGIC_V2);
+        _recoverLeft = _header.Count;
+
+        if (!_recoverV2)
+          _compact = true;
+
+        return true;
+      }
+
+      _compact = true;
+    }
+
+    _OpenLog();
+
+    return true;
+  }
+
+  bool RecoverStep(size_t Limit, std::function<void(uint64_t, float)> put) {
+    if (_recoverStage == _RecoverStage::Segment) {
+      const size_t _want = min(Limit, _recoverLeft);
+      const size_t _read = _recoverV2 ? _ReadBlocks(_recoverFile, _want, put) : _ReadRecords(_recoverFile, _want, put);
+
+      _recoverLeft -= min(_read, _recoverLeft);
+
+      if ((_read < _want) && (_recoverLeft > 0)) {
+        _compact     = true;
+        _recoverLeft = 0;
+      }
+
+      if (_recoverLeft < 1)
+        _OpenLog();
+
+      return true;
+    }
+
+    if (_recoverStage == _RecoverStage::Log) {
+      const size_t _read = _ReadRecords(_recoverFile, Limit, put);
+
+      _logRecords += _read;
+
+      if (_read < Limit) {
+        if (_logRecords * sizeof(_PlotRecord) != _recoverFile.size())
+          _compact = true;
+
+        EndRecover();
+      }
+
+      return true;
+    }
+
+    return false;
+  }
+
+  void EndRecover() {
+    if (_recoverFile)
+      _recoverFile.close();
+
+    _recoverStage = _RecoverStage::Done;
+  }
+
+  // всё сразу
+  size_t Recover(std::function<void(uint64_t, float)> put) {
+    size_t _count = 0;
+
+    auto _put = [&_count, &put](uint64_t Time, float Value) {
+      put(Time, Value);
+      _count++;
+    };
+
+    if (BeginRecover()) {
+      while (RecoverStep(SIZE_MAX, _put))
+        ;
+    }
+
+    return _count;
+  }
+
+  bool Exists() const {
+    return _FS_Initialized && *_segName && (LittleFS.exists(_segName) || LittleFS.exists(_logName) || LittleFS.exists(_tmpName));
+  }
+};
@@ -1,208 +1,823 @@
 #pragma once
 
+#include "_classtype.h"
 #include "_common.h"
+#include "_memory.h"
+#include "_persist.h"
+#include "_plotlog.h"
+#include "_series.h"
 #include <Table.h>
-#include <vector>
 
 #define HIMIDITY_PLOT_SIZE          500
 #define HIMIDITY_PLOT_EPSILON       0.01f
-#define HIMIDITY_PLOT_SAVE_INTERVAL 60ul * 1000ul
 
-class _Plot : public _ClassType {
+#define PLOT_VIEW_POINTS 200
+
+#define PLOT_MEMORY_BUDGET      (24ul * 1024ul)
+#define PLOT_POINT_BITS         81 // на точку: кольцо 64 (смещение + значение), стек RDP 16 (отрезок 4 байта на две точки), битмап 1
+#define PLOT_MIN_SIZE           32
+#define PLOT_BALANCE_INTERVAL   5ul * 60ul * 1000ul
+#define PLOT_EPSILON_STEP       1.5f
+#define PLOT_EPSILON_MAX_FACTOR 16.0f
+#define PLOT_EPSILON_MIN_FACTOR 0.1f
+#define PLOT_RELAX_WINDOW       64 // точек в окне огрубления при полном буфере
+#define PLOT_RELAX_STEPS        4  // окон за одну новую точку: работа на точку не растёт с размером буфера
+#define PLOT_RATE_TOLERANCE     0.2f // адаптивный epsilon не трогаем, пока темп в пределах ±20% от цели
+#define PLOT_ERROR_SAMPLES      32
+#define PLOT_LOAD_CHUNK         PLOT_LOG_BLOCK // точек за один Tick при загрузке
+
+// Метрики сжатия: вход/выход swing door, ошибка восстановления по прямой якорь-кандидат, время пакетного RDP
+struct _PlotStat {
+  ulong    Input             = 0;
+  ulong    Archived          = 0;
+  float    MaxError          = 0;
+  double   SumError          = 0;
+  ulong    ErrorCount        = 0;
+  float    CompressMaxError  = 0;
+  ulong    CompressCount     = 0;
+  ulong    CompressMicros    = 0;
+  ulong    CompressMaxMicros = 0;
+  uint64_t CompressSumMicros = 0;
+
+  void putError(float Error) {
+    MaxError = max(MaxError, Error);
+    SumError += Error;
+    ErrorCount++;
+  }
+
+  void putCompress(ulong Micros) {
+    CompressCount++;
+    CompressMicros    = Micros;
+    CompressMaxMicros = max(CompressMaxMicros, Micros);
+    CompressSumMicros += Micros;
+  }
+
+  float MeanError() const {
+    return (ErrorCount > 0) ? static_cast<float>(SumError / ErrorCount) : 0;
+  }
+
+  // сколько входных точек приходится на одну архивную
+  float Ratio() const {
+    return (Archived > 0) ? static_cast<float>(Input) / Archived : 0;
+  }
+
+  ulong AvgCompressMicros() const {
+    return (CompressCount > 0) ? static_cast<ulong>(CompressSumMicros / CompressCount) : 0;
+  }
+
+  void clear() {
+    *this = _PlotStat();
+  }
+};
+
+class _Plot : public _ClassType, public _Persistent {
+public:
+  using _OnArchive = std::function<void(_Plot &Plot, uint64_t UnixMs, float Value)>;
+
 private:
-  Table _data;
-  Table _point;
-  Table _temp;
+  _OnArchive _on_archive = nullptr;
+
+  // единственное хранилище точек: [0, size - 1) - зафиксированная история, последняя - живой хвост (кандидат swing door)
+  _SeriesBuffer _data;
+  _PlotLog      _log;
+
+  // время последней точки, отданной вебу: после снимка в View() шлём только то, что новее
+  uint64_t _cursor = 0;
 
   size_t _maxSize      = HIMIDITY_PLOT_SIZE;
   float  _epsilon      = HIMIDITY_PLOT_EPSILON;
-  ulong  _saveInterval = HIMIDITY_PLOT_SAVE_INTERVAL;
-  ulong  _saveMillis   = 0;
-
-  static const size_t RDP_STACK_SIZE = 128;
+  float  _baseEpsilon  = HIMIDITY_PLOT_EPSILON;
+  size_t _archived     = 0;
+  bool   _out          = false;
+  size_t _targetRate = 0;
 
   char file_name[50] = "";
 
-  bool _loaded = false;
+  bool _loaded  = false;
+  bool _loading = false;
+  bool _legacy  = false;
+
+  // загрузка с флеша идёт по кускам в Tick(), а живые точки тем временем копятся в _data; в конце склеиваем
+  _SeriesBuffer _stage;
+
+  // до синхронизации RTC точки _data в millis() от старта
+  _SeriesClock _clock;
+
+  _PlotStat _stat;
+
+  ulong  _rateMillis   = 0;
+  size_t _rateArchived = 0;
+
+  // внутренние точки открытого отрезка swing door (мс от якоря, значение) - по ним считается ошибка при фиксации
+  float  _errorDt[PLOT_ERROR_SAMPLES];
+  float  _errorValue[PLOT_ERROR_SAMPLES];
+  size_t _errorCount = 0;
+
+  struct _Segment {
+    uint16_t Start;
+    uint16_t End;
+  };
+
+  // RDP scratch, выделяется под _maxSize: в стеке только непересекающиеся отрезки с внутренними точками, их не больше n / 2
+  uint8_t  *_keep        = nullptr;
+  _Segment *_segments    = nullptr;
+  size_t    _scratchSize = 0;
+
+  // огрубление полного буфера по окнам: своё маленькое scratch, курсор идёт от старых точек к новым
+  uint8_t  _windowKeep[(PLOT_RELAX_WINDOW + 7) / 8];
+  _Segment _windowSegments[PLOT_RELAX_WINDOW / 2 + 1];
+  size_t   _relaxCursor = 0;
+  bool     _relaxFreed  = false;
+
+  // swing door: последняя точка _data - кандидат, пока его наклон лежит внутри конуса от якоря
+  uint64_t _anchorTime  = 0;
+  float    _anchorValue = 0;
+  float    _slopeLow    = 0;
+  float    _slopeHigh   = 0;
+  bool     _anchored    = false;
+  bool     _tentative   = false;
+
+  // расстояние до прямой Start-End в координатах (мс от Start, значение); константы считаются один раз на отрезок
+  struct _Line {
+    int32_t Offset;
+    float   Value;
+    float   dt;
+    float   dv;
+    float   invNorm;
+
+    _Line(const _SeriesBuffer &src, size_t start, size_t end) {
+      Offset  = src.Offset(start);
+      Value   = src.Value(start);
+      dt      = static_cast<float>(src.Offset(end) - Offset);
+      dv      = src.Value(end) - Value;
+      invNorm = 1.0f / sqrtf(dt * dt + dv * dv + 1e-12f);
+    }
 
-  inline float perpendicularDistance(const uint64_t &time1, float value1,
-                                     const uint64_t &time2, float value2,
-                                     const uint64_t &timeP, float valueP) const {
-    const float dx = static_cast<float>(time2 - time1);
-    if (dx == 0)
-      return fabs(valueP - value1);
+    inline float Distance(int32_t offsetP, float valueP) const {
+      return fabsf(dv * static_cast<float>(offsetP - Offset) - dt * (valueP - Value)) * invNorm;
+    }
+  };
 
-    const float slope     = (value2 - value1) / dx;
-    const float intercept = value1 - slope * time1;
-    return fabs(slope * timeP - valueP + intercept) / sqrt(slope * slope + 1.0f);
+  size_t committedSize() const {
+    return _tentative ? _data.size() - 1 : _data.size();
   }
 
-  void rdpCompressImpl(Table &src, std::vector<bool> &keep, float epsilon) {
-    struct Segment {
-      size_t start, end;
+  static size_t segmentsSize(size_t size) {
+    return size / 2 + 1;
+  }
 
-      Segment(size_t s, size_t e) : start(s), end(e) {}
-    };
+  bool allocScratch(size_t size) {
+    if (size == _scratchSize)
+      return true;
 
-    std::vector<Segment> stack;
-    stack.reserve(RDP_STACK_SIZE);
-    stack.emplace_back(0, src.rows() - 1);
+    freeScratch();
 
-    while (!stack.empty() && stack.size() < RDP_STACK_SIZE) {
-      auto segment = stack.back();
-      stack.pop_back();
+    if (size < 1)
+      return true;
 
-      if (segment.end <= segment.start + 1)
-        continue;
+    _keep     = psramAlloc<uint8_t>((size + 7) / 8);
+    _segments = psramAlloc<_Segment>(segmentsSize(size));
+
+    if (!_keep || !_segments) {
+      freeScratch();
+
+      debug.tprintf("%s.allocScratch(%u) failed\n", Name(), (uint)size);
+      return false;
+    }
 
-      uint64_t timeStart  = src[segment.start][0];
-      float    valueStart = src[segment.start][1];
-      uint64_t timeEnd    = src[segment.end][0];
-      float    valueEnd   = src[segment.end][1];
+    _scratchSize = size;
+
+    return true;
+  }
+
+  void freeScratch() {
+    psramFree(_keep);
+    psramFree(_segments);
+
+    _keep        = nullptr;
+    _segments    = nullptr;
+    _scratchSize = 0;
+  }
+
+  static inline void setKeep(uint8_t *keep, size_t i) {
+    keep[i >> 3] |= (1 << (i & 7));
+  }
+
+  static inline bool isKeep(const uint8_t *keep, size_t i) {
+    return keep[i >> 3] & (1 << (i & 7));
+  }
+
+  // RDP по точкам [first, last] буфера; индексы в keep и segments - от first
+  void rdpCompressImpl(const _SeriesBuffer &src, size_t first, size_t last, float epsilon, uint8_t *keep, _Segment *segments) {
+    const size_t rows = last - first + 1;
+
+    memset(keep, 0, (rows + 7) / 8);
+
+    setKeep(keep, 0);
+    setKeep(keep, rows - 1);
+
+    size_t top = 0;
+
+    if (rows > 2)
+      segments[top++] = {0, static_cast<uint16_t>(rows - 1)};
+
+    while (top > 0) {
+      _Segment segment = segments[--top];
+
+      const _Line line(src, first + segment.Start, first + segment.End);
 
       float  maxDist  = 0;
-      size_t maxIndex = segment.start;
+      size_t maxIndex = segment.Start;
 
-      for (size_t i = segment.start + 1; i < segment.end; ++i) {
-        uint64_t timeP  = src[i][0];
-        float    valueP = src[i][1];
-        float    dist   = perpendicularDistance(timeStart, valueStart, timeEnd, valueEnd, timeP, valueP);
+      for (size_t i = segment.Start + 1; i < segment.End; ++i) {
+        float dist = line.Distance(src.Offset(first + i), src.Value(first + i));
         if (dist > maxDist) {
           maxDist  = dist;
           maxIndex = i;
         }
       }
 
-      if (maxDist > epsilon) {
-        keep[maxIndex] = true;
-        stack.emplace_back(segment.start, maxIndex);
-        stack.emplace_back(maxIndex, segment.end);
+      if (maxDist <= epsilon) {
+        _stat.CompressMaxError = max(_stat.CompressMaxError, maxDist);
+        continue;
+      }
+
+      setKeep(keep, maxIndex);
+
+      // отрезки без внутренних точек в стек не кладём, поэтому top < segmentsSize(rows)
+      if (maxIndex > segment.Start + 1U)
+        segments[top++] = {segment.Start, static_cast<uint16_t>(maxIndex)};
+      if (segment.End > maxIndex + 1U)
+        segments[top++] = {static_cast<uint16_t>(maxIndex), segment.End};
+    }
+  }
+
+  // Largest-Triangle-Three-Buckets: ровно points точек из [first, last)
+  void lttbImpl(Table &dest, size_t first, size_t last, size_t points) {
+    const size_t count = last - first;
+
+    dest.removeAll();
+
+    if ((points >= count) || (points < 3)) {
+      for (size_t i = first; i < last; i++)
+        dest.append(_data.Time(i), _data.Value(i));
+
+      return;
+    }
+
+    dest.reserve(points);
+    dest.append(_data.Time(first), _data.Value(first));
+
+    const float every = static_cast<float>(count - 2) / (points - 2);
+
+    size_t a = first;
+
+    for (size_t i = 0; i < points - 2; i++) {
+      size_t nextFrom = first + static_cast<size_t>((i + 1) * every) + 1;
+      size_t nextTo   = min(first + static_cast<size_t>((i + 2) * every) + 1, last);
+
+      if (nextFrom >= nextTo)
+        nextFrom = nextTo - 1;
+
+      float avgOffset = 0;
+      float avgValue  = 0;
+
+      for (size_t j = nextFrom; j < nextTo; j++) {
+        avgOffset += static_cast<float>(_data.Offset(j) - _data.Offset(a));
+        avgValue += _data.Value(j);
+      }
+
+      avgOffset /= (nextTo - nextFrom);
+      avgValue /= (nextTo - nextFrom);
+
+      const size_t from  = first + static_cast<size_t>(i * every) + 1;
+      const size_t to    = first + static_cast<size_t>((i + 1) * every) + 1;
+      const float  value = _data.Value(a);
+
+      float  maxArea  = -1;
+      size_t maxIndex = from;
+
+      for (size_t j = from; j < to; j++) {
+        const float dt   = static_cast<float>(_data.Offset(j) - _data.Offset(a));
+        const float area = fabsf(dt * (avgValue - value) - avgOffset * (_data.Value(j) - value));
+
+        if (area > maxArea) {
+          maxArea  = area;
+          maxIndex = j;
+        }
       }
+
+      dest.append(_data.Time(maxIndex), _data.Value(maxIndex));
+
+      a = maxIndex;
     }
+
+    dest.append(_data.Time(last - 1), _data.Value(last - 1));
   }
 
-  void cutData(Table &data) {
-    while (data.rows() > _maxSize)
-      data.remove(0);
+  void resetStream() {
+    _anchored  = (_data.size() > 0);
+    _tentative = false;
+
+    if (_anchored) {
+      _anchorTime  = _data.LastTime();
+      _anchorValue = _data.LastValue();
+    }
+  }
+
+  // точка зафиксирована: в лог графика и подписчику (долгая история)
+  void archive(uint64_t time, float value) {
+    if (!_clock.IsUnix())
+      return;
+
+    _log.append(time, value);
+
+    if (_on_archive)
+      _on_archive(*this, time, value);
+  }
+
+  // первая синхронизация RTC: точки, набранные по millis(), переезжают на unix и уходят в архив
+  void syncClock() {
+    uint64_t shift = 0;
+
+    if (_clock.IsUnix() || !_clock.sync(_data, &shift))
+      return;
+
+    _anchorTime += shift;
+
+    if (_cursor > 0)
+      _cursor += shift;
+
+    const size_t committed = committedSize();
+
+    for (size_t i = 0; i < committed; i++)
+      archive(_data.Time(i), _data.Value(i));
+
+    debug.tprintf("%s.syncClock() %u pts\n", Name(), (uint)_data.size());
+  }
+
+  void putErrorSample(uint64_t time, float value) {
+    const size_t i = _errorCount++ % PLOT_ERROR_SAMPLES;
+
+    _errorDt[i]    = static_cast<float>(time - _anchorTime);
+    _errorValue[i] = value;
+  }
+
+  // отклонение пропущенных точек от прямой якорь -> кандидат; при длинном отрезке - по последним PLOT_ERROR_SAMPLES
+  void measureError(uint64_t time, float value) {
+    const float  slope = (value - _anchorValue) / static_cast<float>(time - _anchorTime);
+    const size_t count = min(_errorCount, (size_t)PLOT_ERROR_SAMPLES);
+
+    for (size_t i = 0; i < count; i++)
+      _stat.putError(fabsf(_errorValue[i] - (_anchorValue + slope * _errorDt[i])));
+  }
+
+  void openDoor(uint64_t time, float value) {
+    const float dt = static_cast<float>(time - _anchorTime);
+
+    _slopeLow   = (value - _epsilon - _anchorValue) / dt;
+    _slopeHigh  = (value + _epsilon - _anchorValue) / dt;
+    _tentative  = true;
+    _errorCount = 0;
+
+    _data.append(time, value);
+  }
+
+  // буфер полон: огрубляем историю окнами по PLOT_RELAX_WINDOW точек от старых к новым, не больше PLOT_RELAX_STEPS окон за
+  // вызов. Полный проход по буферу без освобождения места поднимает epsilon. Не освободили - append() вытеснит самую старую
+  bool relaxStep() {
+    for (size_t step = 0; step < PLOT_RELAX_STEPS; step++) {
+      const size_t committed = committedSize();
+
+      if (committed < 3)
+        return false;
+
+      if (_relaxCursor + 2 >= committed) {
+        _relaxCursor = 0;
+
+        if (!_relaxFreed) {
+          if (_epsilon >= _baseEpsilon * PLOT_EPSILON_MAX_FACTOR)
+            return false;
+
+          _epsilon = min(_epsilon * PLOT_EPSILON_STEP, _baseEpsilon * PLOT_EPSILON_MAX_FACTOR);
+
+          debug.tprintf("%s.relax(%.4f) %u\n", Name(), _epsilon, (uint)_data.size());
+        }
+
+        _relaxFreed = false;
+      }
+
+      // последняя зафиксированная точка - якорь swing door, RDP её сохраняет как конец окна
+      const size_t first  = _relaxCursor;
+      const size_t last   = min(first + PLOT_RELAX_WINDOW - 1, committed - 1);
+      const size_t before = _data.size();
+
+      ulong _micros = micros();
+
+      rdpCompressImpl(_data, first, last, _epsilon, _windowKeep, _windowSegments);
+
+      _data.compact([this, first, last](size_t i) { return (i > last) || isKeep(_windowKeep, i - first); }, first);
+
+      const size_t removed = before - _data.size();
+
+      _relaxCursor = last - removed;
+
+      if (removed > 0) {
+        _stat.putCompress(micros() - _micros);
+
+        _log.invalidate();
+
+        _relaxFreed = true;
+
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // огрубляем всю историю сразу: новый лимит от _PlotList
+  bool relax() {
+    return relaxBuffer(_data);
+  }
+
+  bool relaxBuffer(_SeriesBuffer &buffer) {
+    if (_epsilon >= _baseEpsilon * PLOT_EPSILON_MAX_FACTOR)
+      return false;
+
+    size_t before = buffer.size();
+
+    _epsilon = min(_epsilon * PLOT_EPSILON_STEP, _baseEpsilon * PLOT_EPSILON_MAX_FACTOR);
+
+    if (&buffer == &_data) {
+      Compress();
+    } else {
+      compressBuffer(buffer);
+
+      _log.invalidate();
+    }
+
+    debug.tprintf("%s.relax(%.4f) %u -> %u\n", Name(), _epsilon, (uint)before, (uint)buffer.size());
+
+    return true;
+  }
+
+  void compressBuffer(_SeriesBuffer &buffer) {
+    if ((_epsilon <= 0) || (buffer.size() <= 2) || (buffer.size() > _scratchSize && !allocScratch(buffer.size())))
+      return;
+
+    ulong _micros = micros();
+
+    rdpCompressImpl(buffer, 0, buffer.size() - 1, _epsilon, _keep, _segments);
+
+    buffer.compact([this](size_t i) { return isKeep(_keep, i); });
+
+    _stat.putCompress(micros() - _micros);
+  }
+
+  void streamValue(uint64_t time, float value) {
+    if (!_anchored || (_epsilon <= 0)) {
+      _stat.Input++;
+      _stat.Archived++;
+
+      _data.append(time, value);
+      archive(time, value);
+
+      _anchorTime  = time;
+      _anchorValue = value;
+      _anchored    = true;
+      _tentative   = false;
+      return;
+    }
+
+    if (time <= (_tentative ? _data.LastTime() : _anchorTime))
+      return;
+
+    _stat.Input++;
+
+    if (!_tentative) {
+      if (_data.size() >= _maxSize)
+        relaxStep();
+
+      openDoor(time, value);
+      return;
+    }
+
+    const float dt    = static_cast<float>(time - _anchorTime);
+    const float slope = (value - _anchorValue) / dt;
+
+    // прямая якорь -> новая точка проходит в пределах epsilon от всех точек с прошлого якоря
+    if ((slope >= _slopeLow) && (slope <= _slopeHigh)) {
+      _slopeLow  = max(_slopeLow, (value - _epsilon - _anchorValue) / dt);
+      _slopeHigh = min(_slopeHigh, (value + _epsilon - _anchorValue) / dt);
+
+      putErrorSample(_data.LastTime(), _data.LastValue());
+
+      _data.setLast(time, value);
+      return;
+    }
+
+    measureError(_data.LastTime(), _data.LastValue());
+
+    _anchorTime  = _data.LastTime();
+    _anchorValue = _data.LastValue();
+
+    archive(_anchorTime, _anchorValue);
+
+    _archived++;
+    _rateArchived++;
+    _stat.Archived++;
+
+    if (_data.size() >= _maxSize)
+      relaxStep();
+
+    openDoor(time, value);
+  }
+
+  // адаптивный режим: держим число архивных точек в час около _targetRate, epsilon в пределах [MIN, MAX] x базовый
+  void adaptEpsilon() {
+    const ulong elapsed = millis() - _rateMillis;
+
+    if (elapsed < PLOT_BALANCE_INTERVAL)
+      return;
+
+    const float rate = _rateArchived * 3600000.0f / elapsed;
+
+    _rateMillis   = millis();
+    _rateArchived = 0;
+
+    if ((_targetRate < 1) || (_baseEpsilon <= 0))
+      return;
+
+    float epsilon = _epsilon;
+
+    if (rate > _targetRate * (1 + PLOT_RATE_TOLERANCE))
+      epsilon = min(_epsilon * PLOT_EPSILON_STEP, _baseEpsilon * PLOT_EPSILON_MAX_FACTOR);
+    else if (rate < _targetRate * (1 - PLOT_RATE_TOLERANCE))
+      epsilon = max(_epsilon / PLOT_EPSILON_STEP, _baseEpsilon * PLOT_EPSILON_MIN_FACTOR);
+
+    if (epsilon != _epsilon) {
+      debug.tprintf("%s.adaptEpsilon(%.1f/h) %.4f -> %.4f\n", Name(), rate, _epsilon, epsilon);
+
+      _epsilon = epsilon;
+    }
+  }
+
+  // одна таблица выдачи на все графики: снимок, дельта и данные собираются в loop и сразу отправляются, поэтому не пересекаются
+  static Table &exportTable() {
+    static Table table(0, 2, cell_t::Uint64, cell_t::Float);
+
+    return table;
   }
 
   void makeFileName() {
-    snprintf(file_name, sizeof(file_name), "/%s_plot.tbl", SubTypeName());
-    toLowerCase(file_name);
+    char base[PLOT_LOG_BASE_MAX];
+
+    snprintf(base, sizeof(base), _out ? "/%s_out_plot" : "/%s_plot", SubTypeName());
+    toLowerCase(base);
+
+    snprintf(file_name, sizeof(file_name), "%s.tbl", base);
+
+    _log.setName(base);
   }
 
-public:
-  _Plot(_SubType subType, size_t maxSize = HIMIDITY_PLOT_SIZE, float epsilon = HIMIDITY_PLOT_EPSILON) {
-    _data.init(2, cell_t::Uint64, cell_t::Float);
-    _point.init(2, cell_t::Uint64, cell_t::Float);
-    _temp.init(2, cell_t::Uint64, cell_t::Float);
+  // старый формат: целая таблица в .tbl, читается один раз и переписывается в сегмент
+  bool loadLegacy() {
+    File f = LittleFS.open(file_name, FILE_READ);
+    if (!f)
+      return false;
 
-    _data.clearChanged();
+    Table &table = exportTable();
 
-    setMaxSize(maxSize);
-    setEpsilon(epsilon);
+    if (!table.readFrom(f, f.size())) {
+      table.removeAll();
+      return false;
+    }
 
-    setMainType(_MainType::Plot);
-    setSubType(subType);
+    for (size_t i = 0; i < table.rows(); i++)
+      loadValue(table[i][0].toInt64(), table[i][1].toFloat());
 
-    makeFileName();
+    table.removeAll();
+
+    _log.invalidate();
+
+    _legacy = true;
+
+    return true;
   }
 
-  void Compress() {
-    if ((_epsilon <= 0) || (_temp.rows() <= 2) || !_temp.changed())
+  void loadValue(uint64_t time, float value) {
+    if ((_stage.size() > 0) && (time <= _stage.LastTime()))
       return;
 
-    std::vector<bool> keep(_temp.rows(), false);
+    if (_stage.size() >= _stage.limit())
+      relaxBuffer(_stage);
 
-    rdpCompressImpl(_temp, keep, _epsilon);
+    _stage.append(time, value);
+  }
 
-    keep.front() = _data.rows() < 1;
-    keep.back()  = true;
+  bool beginLoad() {
+    _loading = false;
 
-    for (size_t i = 0; i < _temp.rows(); ++i) {
-      if (keep[i]) {
-        _data.append(_temp[i][0].toInt64(),
-                     _temp[i][1].toFloat());
-      }
+    if (!_stage.setCapacity(_maxSize)) {
+      finishLoad();
+      return false;
     }
 
-    cutData(_data);
+    if (_log.Exists() && _log.BeginRecover()) {
+      _loading = true;
+      return true;
+    }
 
-    _temp.removeAll();
+    if (LittleFS.exists(file_name))
+      loadLegacy();
 
-    tbl::Row r = _data.get(-1);
+    finishLoad();
 
-    _temp.append(r[0].toInt64(), r[1].toFloat());
-    _temp.clearChanged();
+    return true;
   }
 
-  void putValue(float value) {
-    if (!std::isfinite(value) || !sett.rtc.synced())
+  void loadStep() {
+    if (!_log.RecoverStep(PLOT_LOAD_CHUNK, [this](uint64_t time, float value) { loadValue(time, value); }))
+      finishLoad();
+  }
+
+  // загруженная история + живые точки, пришедшие за время загрузки; не влезает - огрубляем историю
+  void finishLoad() {
+    const size_t loaded = _stage.size();
+    const size_t live   = _data.size();
+
+    while ((_stage.size() + live > _maxSize) && relaxBuffer(_stage))
+      ;
+
+    for (size_t i = 0; i < live; i++) {
+      if ((_stage.size() < 1) || (_data.Time(i) > _stage.LastTime()))
+        _stage.append(_data.Time(i), _data.Value(i));
+    }
+
+    if (_stage.size() > 0)
+      _data.swap(_stage);
+
+    _stage.setCapacity(0);
+    _data.setCapacity(_maxSize);
+
+    if (live < 1)
+      resetStream();
+
+    _log.EndRecover();
+
+    _loading = false;
+    _loaded  = true;
+
+    debug.tprintf("%s.Load() = %u + %u live\n", PersistName(), (uint)loaded, (uint)live);
+  }
+
+public:
+  // память - в begin(): глобальные графики создаются до инициализации PSRAM
+  _Plot(_SubType subType, size_t maxSize = HIMIDITY_PLOT_SIZE, float epsilon = HIMIDITY_PLOT_EPSILON, bool out = false) {
+    _out     = out;
+    _maxSize = maxSize;
+
+    setEpsilon(epsilon);
+
+    setMainType(_MainType::Plot);
+    setSubType(subType);
+
+    makeFileName();
+  }
+
+  ~_Plot() {
+    freeScratch();
+  }
+
+  bool begin() {
+    setMaxSize(_maxSize);
+
+    return (_maxSize < 1) || (_data.limit() > 0);
+  }
+
+  // пакетный RDP по уже накопленным данным: после загрузки файла или смены epsilon
+  void Compress() {
+    if ((_epsilon <= 0) || (_data.size() <= 2) || !allocScratch(_maxSize))
       return;
 
-    uint64_t _unixMs = sett.rtc.getUnixMs();
+    compressBuffer(_data);
 
-    _point.append(_unixMs, value);
+    _log.invalidate();
 
-    cutData(_point);
+    resetStream();
+  }
 
-    if (_maxSize < 1)
+  void putValue(float value) {
+    syncClock();
+
+    const uint64_t time = _clock.Now();
+
+    if (time == 0)
       return;
 
-    _temp.append(_unixMs, value);
+    putValue(time, value);
+  }
 
-    if (_temp.rows() > _maxSize)
-      Compress();
+  // точка с готовым временем: прогон записанных трасс, догрузка истории
+  void putValue(uint64_t unixMs, float value) {
+    if (!std::isfinite(value) || (_maxSize < 1))
+      return;
+
+    streamValue(unixMs, value);
   }
 
+  // новые архивные точки дописываются в лог; после перестройки истории или при разросшемся логе - запечатываем сегмент.
+  // Сама запись идёт в фоновой задаче persist, здесь только снимок. Обычно зовёт persist.Tick(), здесь - вне окна
   bool Save() {
-    if (!_FS_Initialized || !file_name || !*file_name || (_data.rows() < 1 && _temp.rows() < 1))
+    if (!_FS_Initialized || !file_name || !*file_name)
       return false;
 
-    File f = LittleFS.open(file_name, FILE_WRITE);
-    if (!f)
-      return false;
+    return persist.Request(*this);
+  }
 
-    Compress();
+  bool Snapshot() override {
+    return _log.Snapshot(_data, committedSize());
+  }
+
+  bool Flush() override {
+    bool compact = _log.SnapshotCompact();
+    bool result  = _log.Flush();
+
+    written(_log.TakeWritten());
+
+    if (result && compact && _legacy) {
+      LittleFS.remove(file_name);
+
+      _legacy = false;
+    }
+
+    return result;
+  }
 
-    return _data.writeTo(f);
+  const char *PersistName() override {
+    return file_name;
   }
 
+  // до загрузки истории снимок был бы неполным
+  bool IsDirty() override {
+    return _loaded && _log.IsDirty();
+  }
+
+  // загрузка целиком, за один вызов
   bool Load() {
-    if (!_FS_Initialized || !file_name || !*file_name || _maxSize < 1)
-      return false;
+    syncClock();
 
-    File f = LittleFS.open(file_name, FILE_READ);
-    if (!f)
+    if (!_FS_Initialized || !file_name || !*file_name || _maxSize < 1 || !_clock.IsUnix())
       return false;
 
-    if (!_data.readFrom(f, f.size()))
+    if (!_loading && !beginLoad())
       return false;
 
-    Compress();
+    while (_loading)
+      loadStep();
 
     return true;
   }
 
+  bool IsLoaded() const {
+    return _loaded;
+  }
+
+  // первые вызовы - загрузка по PLOT_LOAD_CHUNK точек; запись - в окне persist, см. IsDirty()
   void Tick() {
-    if (_FS_Initialized && (_maxSize > 0) && (_saveInterval > 0) && ((_saveMillis == 0) || ((millis() - _saveMillis) >= _saveInterval))) {
-      _saveMillis = millis();
+    adaptEpsilon();
+    syncClock();
 
-      if (!_loaded) {
-        Load();
+    if (!_FS_Initialized || (_maxSize < 1))
+      return;
 
-        _loaded = true;
-      } else {
-        Save();
-      }
-    }
+    // история на флеше в unix, а живые точки до синхронизации - в millis(): склеиваем только после неё
+    if (_loaded || !_clock.IsUnix())
+      return;
+
+    if (_loading)
+      loadStep();
+    else
+      beginLoad();
   }
 
   void Clear() {
-    _data.removeAll();
-    _temp.removeAll();
+    if (_loading) {
+      _log.EndRecover();
+      _stage.setCapacity(0);
+
+      _loading = false;
+      _loaded  = true;
+    }
+
+    _data.clear();
+
+    _cursor = 0;
 
-    _saveMillis = millis();
+    _log.invalidate();
+
+    resetStream();
   }
 
   size_t MaxSize() const {
@@ -213,42 +828,345 @@ public:
     return _epsilon;
   }
 
-  ulong SaveInterval() const {
-    return _saveInterval;
+  Table &Data() {
+    Table &table = exportTable();
+
+    _data.exportTo(table);
+
+    return table;
   }
 
-  Table &Data() {
-    Compress();
+  // прореженная LTTB выборка за [from, to) для веба: не больше points точек при любой длине истории
+  Table &View(size_t points = PLOT_VIEW_POINTS, uint64_t from = 0, uint64_t to = UINT64_MAX) {
+    const _SeriesView range = Range(from, to);
+    Table            &table = exportTable();
 
+    if (range.empty()) {
+      table.removeAll();
+      return table;
+    }
+
+    lttbImpl(table, range.First(), range.First() + range.size(), points);
+
+    return table;
+  }
+
+  // полный View() действительно ушёл клиенту: дельты дальше - с последней точки
+  void setSent() {
+    if (_data.size() > 0)
+      _cursor = _data.LastTime();
+  }
+
+  // окна без копирования, действительны до следующего putValue()
+  _SeriesView Range(uint64_t from, uint64_t to = UINT64_MAX) const {
+    return _data.Range(from, to);
+  }
+
+  _SeriesView Latest(size_t count) const {
+    return _data.Latest(count);
+  }
+
+  // min/max/avg/first/last за интервалы interval мс в [from, to), см. _SeriesView::aggregate
+  template <typename F>
+  size_t Aggregate(uint64_t from, uint64_t to, uint64_t interval, F put) const {
+    return Range(from, to).aggregate(interval, put);
+  }
+
+  // [uint16 count][поток _SeriesEncoder] для передачи истории целиком
+  size_t Encode(uint8_t *buffer, size_t capacity) {
+    if (capacity < sizeof(uint16_t))
+      return 0;
+
+    _SeriesEncoder encoder(buffer + sizeof(uint16_t), capacity - sizeof(uint16_t));
+
+    uint16_t count = encoder.put(_data, 0, min(_data.size(), (size_t)UINT16_MAX));
+
+    memcpy(buffer, &count, sizeof(count));
+
+    return sizeof(uint16_t) + encoder.bytes();
+  }
+
+  const _SeriesBuffer &Series() const {
     return _data;
   }
 
-  Table &Point() {
-    return _point;
+  // зафиксированная история - то, что уже ушло или уйдёт в лог
+  _SeriesView History() const {
+    return _SeriesView(_data, 0, committedSize());
+  }
+
+  // живой хвост: кандидат swing door, ещё может сдвинуться
+  _SeriesView Tail() const {
+    return _SeriesView(_data, committedSize(), _data.size() - committedSize());
+  }
+
+  // точки новее курсора, включая текущего кандидата swing door: он остаётся у клиента лишней точкой в пределах epsilon
+  bool HasDelta() const {
+    return (_data.size() > 0) && (_data.LastTime() > _cursor);
+  }
+
+  Table &Delta() {
+    const _SeriesView delta = Range(_cursor + 1);
+    Table            &table = exportTable();
+
+    delta.exportTo(table);
+
+    if (!delta.empty())
+      _cursor = delta.Time(delta.size() - 1);
+
+    return table;
   }
 
   size_t CurrentSize() {
-    return _data.rows();
+    return _data.size();
   }
 
   void setMaxSize(size_t size) {
     _maxSize = size;
 
-    if (_maxSize < 1) {
+    allocScratch(_maxSize);
+
+    if (_data.size() > _maxSize)
+      _log.invalidate();
+
+    if (!_data.setCapacity(_maxSize))
+      debug.tprintf("%s.setMaxSize(%u) failed\n", Name(), (uint)size);
+
+    if (_maxSize < 1)
       Clear();
+  }
+
+  void setEpsilon(float epsilon) {
+    _baseEpsilon = epsilon;
 
+    if (_epsilon == epsilon)
       return;
+
+    _epsilon = epsilon;
+
+    Compress();
+    resetStream();
+  }
+
+  float BaseEpsilon() const {
+    return _baseEpsilon;
+  }
+
+  // целевое число архивных точек в час, 0 - epsilon фиксированный
+  void setTargetRate(size_t pointsPerHour) {
+    _targetRate   = pointsPerHour;
+    _rateMillis   = millis();
+    _rateArchived = 0;
+
+    if ((_targetRate < 1) && (_epsilon < _baseEpsilon))
+      _epsilon = _baseEpsilon;
+  }
+
+  size_t TargetRate() const {
+    return _targetRate;
+  }
+
+  const _PlotStat &Stat() const {
+    return _stat;
+  }
+
+  void clearStat() {
+    _stat.clear();
+  }
+
+  // новый лимит от _PlotList: при сжатии сначала огрубляем, обрезаем только если epsilon упёрся в потолок
+  void setBudget(size_t size) {
+    while ((size > 0) && (_data.size() > size) && relax())
+      ;
+
+    if ((size > _maxSize) && (_data.size() < size / 2) && (_epsilon > _baseEpsilon))
+      _epsilon = max(_baseEpsilon, _epsilon / PLOT_EPSILON_STEP);
+
+    if (size != _maxSize)
+      setMaxSize(size);
+  }
+
+  // число архивных точек с прошлого вызова - мера активности сигнала
+  size_t TakeActivity() {
+    size_t result = _archived;
+
+    _archived = 0;
+
+    return result;
+  }
+
+  size_t Bytes() const {
+    return _data.bytes() + (_scratchSize + 7) / 8 + segmentsSize(_scratchSize) * sizeof(_Segment);
+  }
+
+  void OnArchive(_OnArchive cb) {
+    _on_archive = cb;
+  }
+};
+
+class _PlotList {
+private:
+  static const size_t PLOT_COUNT = 6;
+
+  size_t _budget        = PLOT_MEMORY_BUDGET;
+  ulong  _balanceMillis = 0;
+
+  size_t _limits[PLOT_COUNT]  = {HIMIDITY_PLOT_SIZE, HIMIDITY_PLOT_SIZE, HIMIDITY_PLOT_SIZE, HIMIDITY_PLOT_SIZE, HIMIDITY_PLOT_SIZE, HIMIDITY_PLOT_SIZE};
+  float  _weights[PLOT_COUNT] = {1, 1, 1, 1, 1, 1};
+
+  _Plot *_plots[PLOT_COUNT];
+
+  static size_t _FloorPowerOfTwo(size_t Size) {
+    size_t _result = 1;
+
+    while ((_result << 1) <= Size)
+      _result <<= 1;
+
+    return _result;
+  }
+
+public:
+  _Plot TemperatureIn;
+  _Plot HumidityIn;
+  _Plot CO2In;
+
+  _Plot TemperatureOut;
+  _Plot HumidityOut;
+  _Plot CO2Out;
+
+  _PlotList()
+      : TemperatureIn(_SubType::Temperature, PLOT_MIN_SIZE, 0.01f),
+        HumidityIn(_SubType::Humidity, PLOT_MIN_SIZE, HIMIDITY_PLOT_EPSILON),
+        CO2In(_SubType::CO2, PLOT_MIN_SIZE, 1.0f),
+        TemperatureOut(_SubType::Temperature, PLOT_MIN_SIZE, 0.01f, true),
+        HumidityOut(_SubType::Humidity, PLOT_MIN_SIZE, HIMIDITY_PLOT_EPSILON, true),
+        CO2Out(_SubType::CO2, PLOT_MIN_SIZE, 1.0f, true) {
+    _plots[0] = &TemperatureIn;
+    _plots[1] = &HumidityIn;
+    _plots[2] = &CO2In;
+    _plots[3] = &TemperatureOut;
+    _plots[4] = &HumidityOut;
+    _plots[5] = &CO2Out;
+  }
+
+  // из setup(): буферы графиков - после инициализации PSRAM
+  void begin() {
+    for (size_t i = 0; i < PLOT_COUNT; i++)
+      _plots[i]->begin();
+  }
+
+  // верхний предел точек канала (*PlotInSize / *PlotOutSize), 0 - канал выключен
+  void setLimit(_Plot &Plot, size_t Size) {
+    for (size_t i = 0; i < PLOT_COUNT; i++) {
+      if (_plots[i] == &Plot)
+        _limits[i] = min(Size, (size_t)UINT16_MAX); // индексы отрезков RDP - uint16
     }
 
-    if (_data.rows() > _maxSize)
-      cutData(_data);
+    _balanceMillis = 0;
   }
 
-  void setEpsilon(float epsilon) {
-    _epsilon = epsilon;
+  void setBudget(size_t Bytes) {
+    _budget        = Bytes;
+    _balanceMillis = 0;
+  }
+
+  size_t Budget() const {
+    return _budget;
+  }
+
+  size_t Bytes() const {
+    size_t _result = 0;
+
+    for (size_t i = 0; i < PLOT_COUNT; i++)
+      _result += _plots[i]->Bytes();
+
+    return _result;
+  }
+
+  // делит бюджет пропорционально активности (EMA числа архивных точек), размеры - степени двойки
+  void Balance() {
+    float _sum = 0;
+
+    for (size_t i = 0; i < PLOT_COUNT; i++) {
+      _weights[i] = 0.7f * _weights[i] + 0.3f * (1 + _plots[i]->TakeActivity());
+
+      if (_limits[i] > 0)
+        _sum += _weights[i];
+    }
+
+    const size_t _points = _budget * 8 / PLOT_POINT_BITS;
+
+    for (size_t i = 0; i < PLOT_COUNT; i++) {
+      if (_limits[i] < 1) {
+        _plots[i]->setBudget(0);
+        continue;
+      }
+
+      size_t _share = static_cast<size_t>(_points * _weights[i] / _sum);
+
+      _share = _FloorPowerOfTwo(max(_share, (size_t)PLOT_MIN_SIZE));
+
+      _plots[i]->setBudget(min(_share, _limits[i]));
+    }
+
+    _balanceMillis = millis();
   }
 
-  void setSaveInterval(ulong interval) {
-    _saveInterval = interval;
+  bool IsLoaded() const {
+    for (size_t i = 0; i < PLOT_COUNT; i++) {
+      if (!_plots[i]->IsLoaded())
+        return false;
+    }
+
+    return true;
+  }
+
+  // загружается по одному графику за раз, чтобы не держать открытыми файлы всех сразу
+  void Tick() {
+    if ((_balanceMillis == 0) || ((millis() - _balanceMillis) >= PLOT_BALANCE_INTERVAL))
+      Balance();
+
+    bool loading = false;
+
+    for (size_t i = 0; i < PLOT_COUNT; i++) {
+      if (!_plots[i]->IsLoaded()) {
+        if (loading)
+          continue;
+
+        loading = true;
+      }
+
+      _plots[i]->Tick();
+    }
+  }
+
+  // номер канала в долгой истории
+  uint16_t Channel(const _Plot &Plot) const {
+    for (size_t i = 0; i < PLOT_COUNT; i++) {
+      if (_plots[i] == &Plot)
+        return i;
+    }
+
+    return UINT16_MAX;
+  }
+
+  void OnArchive(_Plot::_OnArchive cb) {
+    for (size_t i = 0; i < PLOT_COUNT; i++)
+      _plots[i]->OnArchive(cb);
+  }
+
+  void setTargetRate(size_t PointsPerHour) {
+    for (size_t i = 0; i < PLOT_COUNT; i++)
+      _plots[i]->setTargetRate(PointsPerHour);
+  }
+
+  void clearStat() {
+    for (size_t i = 0; i < PLOT_COUNT; i++)
+      _plots[i]->clearStat();
+  }
+
+  void Clear() {
+    for (size_t i = 0; i < PLOT_COUNT; i++)
+      _plots[i]->Clear();
   }
 };
@@ -7,6 +7,8 @@
 
 #include "_classtype.h"
 #include "_common.h"
+#include "_memory.h"
+#include "_series.h"
 
 #define DHT22_TEMPERATURE_ACCURACY  0.5f
 #define DHT22_HUMIDITY_ACCURACY     2.0f
@@ -98,6 +100,7 @@ private:
       return;
     }
 
+    // кольцо сглаживания маленькое и читается на каждом образце - во внутренней памяти
     float *new_stack = new (std::nothrow) float[size_max];
 
     if (!new_stack)
@@ -123,8 +126,7 @@ private:
   }
 
   void _Destroy() {
-    if (_stack)
-      delete[] _stack;
+    delete[] _stack;
 
     _stack = nullptr;
   }
@@ -177,6 +179,69 @@ public:
     return _Value;
   }
 
+  float putValues(const _Sample *Samples, size_t Count, _Sample *Smoothed = nullptr) {
+    if (!Samples || (Count < 1))
+      return _Value;
+
+    if (!IsEnabled()) {
+      if (Smoothed && (Smoothed != Samples))
+        memcpy(Smoothed, Samples, Count * sizeof(_Sample));
+
+      return Samples[Count - 1].Value;
+    }
+
+    float  _blockSum   = _sum;
+    size_t _blockSize  = _size;
+    size_t _blockStart = _start;
+    float  _blockValue = _Value;
+
+    for (size_t i = 0; i < Count; i++) {
+      float value = Samples[i].Value;
+
+      if (std::isfinite(value)) {
+        if (_blockSize < _size_max) {
+          _stack[(_blockStart + _blockSize) % _size_max] = value;
+          _blockSum += value;
+          _blockSize++;
+        } else {
+          _blockSum -= _stack[_blockStart];
+          _blockSum += value;
+          _stack[_blockStart] = value;
+
+          _blockStart = (_blockStart + 1) % _size_max;
+        }
+
+        _blockValue = _blockSum / static_cast<float>(_blockSize);
+      }
+
+      if (Smoothed) {
+        Smoothed[i].UnixMs = Samples[i].UnixMs;
+        Smoothed[i].Millis = Samples[i].Millis;
+        Smoothed[i].Value  = _blockValue;
+      }
+    }
+
+    _sum   = _blockSum;
+    _size  = _blockSize;
+    _start = _blockStart;
+    _Value = _blockValue;
+
+    return _Value;
+  }
+
+  // окно в новых единицах без пересчёта: смена поправки
+  void shift(float Delta) {
+    if (!IsEnabled() || (_size < 1))
+      return;
+
+    for (size_t i = 0; i < _size; i++)
+      _stack[(_start + i) % _size_max] += Delta;
+
+    _sum += Delta * static_cast<float>(_size);
+
+    _Value = _sum / static_cast<float>(_size);
+  }
+
   float Value() {
     return _Value;
   }
@@ -253,84 +318,9 @@ private:
   //     _on_enabled_change(*this, false);
   // }
 
-public:
-  _ChangeEvents Events;
-
-  ulong MillisFrom = 0;
-  ulong MillisTo   = 0;
-
-  ulong Duration = 0;
-
-  float ValueFrom = 0;
-  float ValueTo   = 0;
-
-  float Min = 0;
-  float Max = 0;
-
-  ulong MinMillis = 0;
-  ulong MaxMillis = 0;
-
-  float Diff           = 0;
-  float DiffHysteresis = 0;
-
-  float TotalDiff        = 0;
-  float TotalDiffPercent = 0;
-
-  float Sum = 0;
-  float Avg = 0;
-
-  float Incrase = 0;
-  float Decrase = 0;
-
-  uint64_t Count = 0;
-
-  bool IsValid = false;
-
-  _ReadingsStat(_Readings &Readings) : _ClassOwner<_Readings>(Readings) {
-    setMainType(_MainType::Stat);
-  }
-
-  void clear() {
-    MillisFrom = 0;
-    MillisTo   = 0;
-
-    Duration = 0;
-
-    ValueFrom = 0;
-    ValueTo   = 0;
-
-    Min = 0;
-    Max = 0;
-
-    MinMillis = 0;
-    MaxMillis = 0;
-
-    Diff           = 0;
-    DiffHysteresis = 0;
-
-    TotalDiff        = 0;
-    TotalDiffPercent = 0;
-
-    Sum = 0;
-    Avg = 0;
-
-    Incrase = 0;
-    Decrase = 0;
-
-    Count = 0;
-
-    IsValid = false;
-
-    Events.clear();
-  }
-
-  void Reload() {
-    clear();
-  }
-
-  void putValue(float Value) {
+  bool _putValue(float Value, ulong _millis, bool Notify, bool &IsChanged, bool &IsRevert) {
     if (!_IsEnabled || !std::isfinite(Value))
-      return;
+      return false;
 
     // if (!_IsEnabled && !_IsWaiting)
     //   return;
@@ -347,8 +337,6 @@ public:
       clear();
     }
 
-    ulong _millis = millis();
-
     Count++;
 
     if (!IsValid) {
@@ -389,7 +377,7 @@ public:
       float _diff_abs = fabsf(_diff);
 
       if (_diff_abs > _Hysteresis) {
-        bool IsRevert = false;
+        IsChanged = true;
 
         if (Events.Change.IsValid && (Events.Change.Diff * _diff) < 0) {
           IsRevert = true;
@@ -400,7 +388,7 @@ public:
           Events.Revert.Millis  = _millis;
           Events.Revert.IsValid = true;
 
-          if (_on_direction_change)
+          if (Notify && _on_direction_change)
             _on_direction_change(*this, Events.Change.New, Value, Value > Events.Change.New);
         }
 
@@ -430,18 +418,176 @@ public:
         Events.Change.Millis  = _millis;
         Events.Change.IsValid = true;
 
-        if (_on_value_change)
+        if (Notify && _on_value_change)
           _on_value_change(*this, Events.Change.Old, Events.Change.New, Events.Change.New > Events.Change.Old, IsRevert);
       }
     }
 
     IsValid = true;
 
-    if (_on_value_add)
+    if (Notify && _on_value_add)
       _on_value_add(*this, Value, LastChangeMillisElapsed());
 
     // if (_IsWaiting && (Events.Change.IsRevert || (LastChangeMillisElapsed() > 5000)))
     //   _setWaiting(false);
+
+    return true;
+  }
+
+public:
+  struct _Batch {
+    float Old      = 0;
+    bool  Added    = false;
+    bool  Changed  = false;
+    bool  Reverted = false;
+  };
+
+  _ChangeEvents Events;
+
+  ulong MillisFrom = 0;
+  ulong MillisTo   = 0;
+
+  ulong Duration = 0;
+
+  float ValueFrom = 0;
+  float ValueTo   = 0;
+
+  float Min = 0;
+  float Max = 0;
+
+  ulong MinMillis = 0;
+  ulong MaxMillis = 0;
+
+  float Diff           = 0;
+  float DiffHysteresis = 0;
+
+  float TotalDiff        = 0;
+  float TotalDiffPercent = 0;
+
+  float Sum = 0;
+  float Avg = 0;
+
+  float Incrase = 0;
+  float Decrase = 0;
+
+  uint64_t Count = 0;
+
+  bool IsValid = false;
+
+  _ReadingsStat(_Readings &Readings) : _ClassOwner<_Readings>(Readings) {
+    setMainType(_MainType::Stat);
+  }
+
+  void clear() {
+    MillisFrom = 0;
+    MillisTo   = 0;
+
+    Duration = 0;
+
+    ValueFrom = 0;
+    ValueTo   = 0;
+
+    Min = 0;
+    Max = 0;
+
+    MinMillis = 0;
+    MaxMillis = 0;
+
+    Diff           = 0;
+    DiffHysteresis = 0;
+
+    TotalDiff        = 0;
+    TotalDiffPercent = 0;
+
+    Sum = 0;
+    Avg = 0;
+
+    Incrase = 0;
+    Decrase = 0;
+
+    Count = 0;
+
+    IsValid = false;
+
+    Events.clear();
+  }
+
+  void Reload() {
+    clear();
+  }
+
+  // все накопленные значения сдвигаются на Delta, разности и события по гистерезису не меняются
+  void shift(float Delta) {
+    if (!IsValid)
+      return;
+
+    ValueFrom += Delta;
+    ValueTo += Delta;
+    Min += Delta;
+    Max += Delta;
+
+    Sum += Delta * static_cast<float>(Count);
+    Avg = (Count > 0) ? Sum / static_cast<float>(Count) : 0;
+
+    TotalDiffPercent = (Max != 0) ? TotalDiff * (100.0 / Max) : 0;
+
+    for (_ChangeEvent *_event : {&Events.Change, &Events.Revert, &Events.Increase, &Events.Decrease}) {
+      _event->Old += Delta;
+      _event->New += Delta;
+    }
+  }
+
+  void putValue(float Value) {
+    bool _changed = false;
+    bool _revert  = false;
+
+    _putValue(Value, millis(), true, _changed, _revert);
+  }
+
+  _Batch beginBatch() const {
+    _Batch _batch;
+
+    _batch.Old = Events.Change.New;
+
+    return _batch;
+  }
+
+  // пакет по частям: события копятся в Batch, колбэки - один раз в notify()
+  void putValues(const _Sample *Samples, size_t Count, _Batch &Batch) {
+    if (!_IsEnabled || !Samples || (Count < 1))
+      return;
+
+    for (size_t i = 0; i < Count; i++) {
+      bool _revert = false;
+
+      Batch.Added |= _putValue(Samples[i].Value,
+                               (Samples[i].Millis > 0) ? Samples[i].Millis : millis(),
+                               false,
+                               Batch.Changed,
+                               _revert);
+
+      Batch.Reverted |= _revert;
+    }
+  }
+
+  void notify(const _Batch &Batch) {
+    if (Batch.Reverted && _on_direction_change)
+      _on_direction_change(*this, Events.Revert.Old, Events.Revert.New, Events.Revert.New > Events.Revert.Old);
+
+    if (Batch.Changed && _on_value_change)
+      _on_value_change(*this, Batch.Old, Events.Change.New, Events.Change.New > Batch.Old, Batch.Reverted);
+
+    if (Batch.Added && _on_value_add)
+      _on_value_add(*this, ValueTo, LastChangeMillisElapsed());
+  }
+
+  void putValues(const _Sample *Samples, size_t Count, bool Notify = true) {
+    _Batch _batch = beginBatch();
+
+    putValues(Samples, Count, _batch);
+
+    if (Notify)
+      notify(_batch);
   }
 
   bool IsUp(ulong Period = 0) {
@@ -529,37 +675,89 @@ public:
 
 class _ReadingsHistory : public _ClassType, public _ClassOwner<_Readings> {
 private:
-  Table _All;
-  Table _New;
+  _SeriesBuffer _All;
+  _SeriesClock  _Clock;
 
   size_t _StoreMinutes = 0;
 
+  uint64_t _StoreMs() const {
+    return static_cast<uint64_t>(_StoreMinutes) * 60000ull;
+  }
+
+  void _Append(uint64_t Time, float Value) {
+    // память - с первого образца, не в конструкторе глобального объекта: PSRAM к тому времени уже доступна
+    if ((_All.limit() < 1) && !_All.setCapacity(READINGS_HISTORY_SIZE))
+      return;
+
+    // кольцо полно, а старейшая точка ещё в окне хранения - расширяем вместо потери
+    const size_t _max = READINGS_HISTORY_SIZE_MAX * historyScale();
+
+    if ((_All.size() >= _All.limit()) && (_All.limit() < _max) && ((Time - _All.Time(0)) <= _StoreMs()))
+      _All.setCapacity(min(_All.limit() * 2, _max));
+
+    _All.append(Time, Value);
+  }
+
+  void _Trim(uint64_t Time) {
+    while ((_All.size() > 0) && ((Time - _All.Time(0)) > _StoreMs()))
+      _All.removeFirst();
+  }
+
 public:
   _ReadingsHistory(_Readings &Readings, size_t StoreMinutes = 0) : _ClassOwner<_Readings>(Readings) {
-    setStoreMinutes(StoreMinutes);
-
-    _All.init(2, cell_t::Uint64, cell_t::Float);
-    _New.init(2, cell_t::Uint64, cell_t::Float);
+    _StoreMinutes = StoreMinutes;
 
     setMainType(_MainType::History);
   }
 
   void putValue(float Value) {
-    if (_StoreMinutes < 1 || !std::isfinite(Value) || !sett.rtc.synced())
+    if (_StoreMinutes < 1 || !std::isfinite(Value))
       return;
 
-    uint64_t _unixMs = sett.rtc.getUnixMs();
+    _Clock.sync(_All);
+
+    const uint64_t _time = _Clock.Now();
+
+    if (_time == 0)
+      return;
+
+    _Append(_time, Value);
+    _Trim(_time);
+  }
+
+  // до синхронизации RTC у образцов нет UnixMs - берём их Millis в шкале ряда
+  void putValues(const _Sample *Samples, size_t Count) {
+    if (_StoreMinutes < 1 || !Samples || (Count < 1))
+      return;
+
+    _Clock.sync(_All);
+
+    uint64_t _lastMs = 0;
+
+    for (size_t i = 0; i < Count; i++) {
+      if (!std::isfinite(Samples[i].Value))
+        continue;
+
+      const uint64_t _time = (_Clock.IsUnix() && (Samples[i].UnixMs > 0)) ? Samples[i].UnixMs : _Clock.At(Samples[i].Millis);
+
+      if (_time == 0)
+        continue;
 
-    _New.append(_unixMs, Value);
+      _Append(_time, Samples[i].Value);
 
-    _All.append(_unixMs, Value);
-    while ((_unixMs - _All[0][0].toInt64()) > (static_cast<uint64_t>(_StoreMinutes) * 60000ull))
-      _All.remove(0);
+      _lastMs = max(_lastMs, _time);
+    }
+
+    if (_lastMs > 0)
+      _Trim(_lastMs);
   }
 
   void clear() {
-    _All.removeAll();
-    _New.removeAll();
+    _All.clear();
+  }
+
+  void shift(float Delta) {
+    _All.shiftValues(Delta);
   }
 
   bool Enabled() {
@@ -570,27 +768,38 @@ public:
     _StoreMinutes = Value;
 
     if (_StoreMinutes < 1)
-      clear();
+      _All.setCapacity(0);
   }
 
   size_t StoreMinutes() {
     return _StoreMinutes;
   }
 
-  Table &All() {
-    return _All;
+  _SeriesView All() const {
+    return _All.All();
   }
 
-  const Table &All() const {
-    return _All;
+  // false - метки ещё в millis() от старта, RTC не синхронизирована
+  bool IsUnix() const {
+    return _Clock.IsUnix();
   }
 
-  Table &New() {
-    return _New;
+  ulong ToMillis(uint64_t Time) const {
+    return _Clock.ToMillis(Time);
   }
 
-  const Table &New() const {
-    return _New;
+  // окна без копирования, действительны до следующего putValue()
+  _SeriesView Range(uint64_t FromMs, uint64_t ToMs = UINT64_MAX) const {
+    return _All.Range(FromMs, ToMs);
+  }
+
+  _SeriesView Latest(size_t Count) const {
+    return _All.Latest(Count);
+  }
+
+  template <typename F>
+  size_t Aggregate(uint64_t FromMs, uint64_t ToMs, uint64_t IntervalMs, F Put) const {
+    return Range(FromMs, ToMs).aggregate(IntervalMs, Put);
   }
 };
 
@@ -602,19 +811,89 @@ public:
   using _OnGetText     = std::function<void(char *Text)>;
   using _OnGetPrefix   = std::function<void(char *Prefix)>;
   using _OnGetPostfix  = std::function<void(char *Postfix)>;
+  using _OnSample      = std::function<void(_Readings &Readings, float Value)>;
 
 private:
-  float _Offset      = 0;
-  float _Accuracy    = 0;
-  float _Value       = 0;
-  char  _Text[50]    = "";
-  char  _Prefix[10]  = "";
-  char  _Postfix[10] = "";
+  float _Offset       = 0;
+  float _Accuracy     = 0;
+  float _Value        = 0;
+  ulong _SampleMicros = 0;
+  char  _Text[50]     = "";
+  char  _Prefix[10]   = "";
+  char  _Postfix[10]  = "";
+
+  // смена поправки ещё не применена к накопленному; применяется в _Rebuild()
+  float _OffsetDelta = 0;
+
+  bool _IsDirty = false;
 
   _OnGetAccuracy _on_get_accuracy = nullptr;
   _OnGetText     _on_get_text     = nullptr;
   _OnGetPrefix   _on_get_prefix   = nullptr;
   _OnGetPrefix   _on_get_postfix  = nullptr;
+  _OnSample      _on_sample       = nullptr;
+
+  void _Rebuild() {
+    // поправка сменилась: накопленное переводится в новые единицы сдвигом, пересчёт не нужен
+    if (_OffsetDelta != 0) {
+      History.shift(_OffsetDelta);
+      Stack.shift(_OffsetDelta);
+      Stat.shift(_OffsetDelta);
+
+      _Value += _OffsetDelta;
+
+      _OffsetDelta = 0;
+    }
+
+    if (!_IsDirty)
+      return;
+
+    _IsDirty = false;
+
+    _SeriesView  _all  = History.All();
+    const size_t _rows = _all.size();
+
+    if (!History.Enabled() || (_rows < 1))
+      return;
+
+    // Stat пересчитывается, только если история покрывает его целиком; иначе агрегаты остаются как есть,
+    // а новый гистерезис действует с следующего показания
+    const ulong _millisFrom = Stat.MillisFrom;
+    const bool  _replay     = Stat.IsEnabled() && Stat.IsValid &&
+                         (static_cast<long>(History.ToMillis(_all.Time(0)) - _millisFrom) <= 0);
+
+    const size_t _first = _replay ? 0 : _rows - min(_rows, Stack.Size());
+
+    Stack.clear();
+
+    if (_replay)
+      Stat.clear();
+
+    _Sample               _chunk[READINGS_BATCH_CHUNK];
+    _ReadingsStat::_Batch _batch = Stat.beginBatch();
+
+    for (size_t _from = _first; _from < _rows; _from += READINGS_BATCH_CHUNK) {
+      const size_t _count = min(_rows - _from, (size_t)READINGS_BATCH_CHUNK);
+
+      size_t _stat = _count;
+
+      for (size_t i = 0; i < _count; i++) {
+        _chunk[i].UnixMs = History.IsUnix() ? _all.Time(_from + i) : 0;
+        _chunk[i].Millis = History.ToMillis(_all.Time(_from + i));
+        _chunk[i].Value  = _all.Value(_from + i);
+
+        if ((_stat == _count) && (static_cast<long>(_chunk[i].Millis - _millisFrom) >= 0))
+          _stat = i;
+      }
+
+      _Value = Stack.putValues(_chunk, _count, _chunk);
+
+      if (_replay)
+        Stat.putValues(_chunk + _stat, _count - _stat, _batch);
+    }
+
+    debug.tprintf("%s.Rebuild(%u%s)\n", Name(), (uint)(_rows - _first), _replay ? ", stat" : "");
+  }
 
   void _getText() {
     if (_on_get_text)
@@ -650,6 +929,7 @@ private:
   }
 
 public:
+  // в History - показания с поправкой, до сглаживания: из них пересобираются Stack и Stat
   _ReadingsHistory History;
   _ReadingsStack   Stack;
   _ReadingsStat    Stat;
@@ -673,17 +953,68 @@ public:
     Stat.clear();
   }
 
-  void putValue(float Value) {
-    _Value = Stack.putValue(Value + _Offset);
+  // одно показание, время - сейчас
+  void putValue(float Value, ulong SampleMicros = 0) {
+    _Sample _sample;
+
+    _sample.UnixMs = sett.rtc.synced() ? sett.rtc.getUnixMs() : 0;
+    _sample.Millis = millis();
+    _sample.Value  = Value;
 
-    History.putValue(_Value);
-    Stat.putValue(_Value);
+    putValues(&_sample, 1, SampleMicros);
+  }
+
+  // пакет образцов со своими метками: проходы по READINGS_BATCH_CHUNK через буфер на стеке, без выделения памяти;
+  // колбэки Stat - один раз на весь пакет
+  void putValues(const _Sample *Samples, size_t Count, ulong SampleMicros = 0) {
+    if (!Samples || (Count < 1))
+      return;
+
+    _SampleMicros = (SampleMicros > 0) ? SampleMicros : micros();
+
+    _Rebuild();
+
+    _Sample               _chunk[READINGS_BATCH_CHUNK];
+    _ReadingsStat::_Batch _batch = Stat.beginBatch();
+
+    for (size_t _from = 0; _from < Count; _from += READINGS_BATCH_CHUNK) {
+      const size_t _count = min(Count - _from, (size_t)READINGS_BATCH_CHUNK);
+
+      for (size_t i = 0; i < _count; i++) {
+        _chunk[i]        = Samples[_from + i];
+        _chunk[i].Value += _Offset;
+
+        if (_on_sample)
+          _on_sample(*this, _chunk[i].Value);
+      }
+
+      History.putValues(_chunk, _count);
+
+      _Value = Stack.putValues(_chunk, _count, _chunk);
+
+      Stat.putValues(_chunk, _count, _batch);
+    }
+
+    Stat.notify(_batch);
   }
 
   float Value() {
     return _Value;
   }
 
+  ulong SampleMicros() {
+    return _SampleMicros;
+  }
+
+  // время образца для трассы задержки - один раз на образец; 0, если нового образца не было
+  ulong takeSampleMicros() {
+    ulong _result = _SampleMicros;
+
+    _SampleMicros = 0;
+
+    return _result;
+  }
+
   void setPrefix(const char *Prefix) {
     char _buf[10];
 
@@ -731,6 +1062,8 @@ public:
   }
 
   void setOffset(float Value = 0) {
+    _OffsetDelta += Value - _Offset;
+
     _Offset = Value;
   }
 
@@ -769,6 +1102,12 @@ public:
       _on_get_postfix = cb;
   }
 
+  // каждое показание с поправкой, до сглаживания
+  void OnSample(_OnSample cb) {
+    if (cb)
+      _on_sample = cb;
+  }
+
   int Compare(float value = 0, float accuracy = 0) {
     return cmp::Compare(Value(), Accuracy(), value, accuracy);
   }
@@ -818,6 +1157,9 @@ public:
   }
 
   void setHysteresis(float Value = 0) {
+    if (Stat.Hysteresis() != Value)
+      _IsDirty = true;
+
     Stat.setHysteresis(Value);
   }
 
@@ -826,6 +1168,9 @@ public:
   }
 
   void setStackSize(size_t Value = 0) {
+    if (Stack.Size() != Value)
+      _IsDirty = true;
+
     Stack.setSize(Value);
   }
 
@@ -913,6 +1258,10 @@ public:
       _result = getReadings();
     }
 
+    _SampleMicros = micros();
+    _SampleMillis = millis();
+    _SampleUnixMs = sett.rtc.synced() ? sett.rtc.getUnixMs() : 0;
+
     if (!_setActive(_result))
       return;
 
@@ -972,11 +1321,25 @@ public:
   }
 
 protected:
-  ulong _HeatingTime = 0;
-  ulong _StartMillis = 0;
+  ulong    _HeatingTime  = 0;
+  ulong    _StartMillis  = 0;
+  ulong    _SampleMicros = 0;
+  ulong    _SampleMillis = 0;
+  uint64_t _SampleUnixMs = 0;
 
   bool _IsActive = false;
 
+  // показание с метками момента опроса: в _Readings идёт пакетом, а не со временем обработки
+  _Sample Sample(float Value) const {
+    _Sample _sample;
+
+    _sample.UnixMs = _SampleUnixMs;
+    _sample.Millis = _SampleMillis;
+    _sample.Value  = Value;
+
+    return _sample;
+  }
+
   virtual void OnInit() {
   }
 
@@ -1035,8 +1398,11 @@ public:
   }
 
   virtual void OnUpdate() override {
-    Temperature.putValue(_temperature);
-    Humidity.putValue(_humidity);
+    _Sample _temperature_sample = Sample(_temperature);
+    _Sample _humidity_sample    = Sample(_humidity);
+
+    Temperature.putValues(&_temperature_sample, 1, _SampleMicros);
+    Humidity.putValues(&_humidity_sample, 1, _SampleMicros);
   }
 
   virtual void OnReload() override {
@@ -1351,7 +1717,9 @@ protected:
     if (IsHeating())
       return;
 
-    CO2.putValue(_co2);
+    _Sample _co2_sample = Sample(_co2);
+
+    CO2.putValues(&_co2_sample, 1, _SampleMicros);
   }
 
   void OnReload() override {
@@ -1371,10 +1739,10 @@ public:
   _SensorMHZ19  mhz19in;
   _SensorMHZ19  mhz19out;
 
-  _SensorList() : dht22in(*this, DHT_PIN),
-                  dht22out(*this, DHT_EX_PIN),
-                  mhz19in(*this, 1, CO2_RX_PIN, CO2_TX_PIN, MHZ19_HEATING_TIME),
-                  mhz19out(*this, 2, CO2_EX_RX_PIN, CO2_EX_TX_PIN, MHZ19_HEATING_TIME) {
+  _SensorList() : dht22in(*this, DHT_PIN, READINGS_HISTORY_MINUTES, READINGS_HISTORY_MINUTES),
+                  dht22out(*this, DHT_EX_PIN, READINGS_HISTORY_MINUTES, READINGS_HISTORY_MINUTES),
+                  mhz19in(*this, 1, CO2_RX_PIN, CO2_TX_PIN, MHZ19_HEATING_TIME, READINGS_HISTORY_MINUTES),
+                  mhz19out(*this, 2, CO2_EX_RX_PIN, CO2_EX_TX_PIN, MHZ19_HEATING_TIME, READINGS_HISTORY_MINUTES) {
     dht22in.setLocation(_SensorLocation::Inside);
     dht22out.setLocation(_SensorLocation::Outside);
     mhz19in.setLocation(_SensorLocation::Inside);
@@ -1520,4 +1888,16 @@ public:
     mhz19in.CO2.Stat.OnValueAdd(cb);
     mhz19out.CO2.Stat.OnValueAdd(cb);
   }
+
+  void OnReadingsSample(_Readings::_OnSample cb) {
+    if (!cb)
+      return;
+
+    dht22in.Temperature.OnSample(cb);
+    dht22in.Humidity.OnSample(cb);
+    dht22out.Temperature.OnSample(cb);
+    dht22out.Humidity.OnSample(cb);
+    mhz19in.CO2.OnSample(cb);
+    mhz19out.CO2.OnSample(cb);
+  }
 };
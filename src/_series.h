@@ -0,0 +1,537 @@
+#pragma once
+
+#include "_common.h"
+#include "_memory.h"
+#include <Table.h>
+
+class _SeriesBuffer;
+
+// Агрегат одного интервала группировки; From кратно интервалу (от эпохи Unix)
+struct _SeriesAggregate {
+  uint64_t From  = 0;
+  uint32_t Count = 0;
+  float    Min   = 0;
+  float    Max   = 0;
+  float    First = 0;
+  float    Last  = 0;
+  double   Sum   = 0;
+
+  // среднее по хранимым точкам: для прореженного графика это не среднее по времени
+  float Avg() const {
+    return (Count > 0) ? static_cast<float>(Sum / Count) : 0;
+  }
+};
+
+// Группировка упорядоченного по времени потока точек: Put(const _SeriesAggregate &) на каждый непустой интервал
+template <typename F>
+class _SeriesGrouper {
+private:
+  uint64_t         _interval = 0;
+  F               &_put;
+  _SeriesAggregate _group;
+  size_t           _groups = 0;
+
+public:
+  _SeriesGrouper(uint64_t Interval, F &Put) : _interval(Interval), _put(Put) {
+  }
+
+  void put(uint64_t Time, float Value) {
+    const uint64_t _from = Time - Time % _interval;
+
+    if ((_group.Count > 0) && (_from != _group.From)) {
+      _put(_group);
+      _groups++;
+
+      _group.Count = 0;
+    }
+
+    if (_group.Count < 1) {
+      _group.From  = _from;
+      _group.Min   = Value;
+      _group.Max   = Value;
+      _group.First = Value;
+      _group.Sum   = 0;
+    }
+
+    _group.Min  = min(_group.Min, Value);
+    _group.Max  = max(_group.Max, Value);
+    _group.Last = Value;
+    _group.Sum += Value;
+    _group.Count++;
+  }
+
+  // отдаёт последний незакрытый интервал, возвращает число интервалов
+  size_t finish() {
+    if (_group.Count > 0) {
+      _put(_group);
+      _groups++;
+
+      _group.Count = 0;
+    }
+
+    return _groups;
+  }
+};
+
+// Невладеющее окно [First, First + Count) над _SeriesBuffer; действительно до следующей записи в буфер
+class _SeriesView {
+private:
+  const _SeriesBuffer *_data  = nullptr;
+  size_t               _first = 0;
+  size_t               _count = 0;
+
+public:
+  _SeriesView() {
+  }
+
+  _SeriesView(const _SeriesBuffer &Data, size_t First, size_t Count) : _data(&Data), _first(First), _count(Count) {
+  }
+
+  size_t size() const {
+    return _count;
+  }
+
+  bool empty() const {
+    return _count < 1;
+  }
+
+  size_t First() const {
+    return _first;
+  }
+
+  const _SeriesBuffer &Data() const {
+    return *_data;
+  }
+
+  inline uint64_t Time(size_t i) const;
+  inline float    Value(size_t i) const;
+  inline int32_t  Offset(size_t i) const;
+
+  void exportTo(Table &Dest) const;
+
+  // группировка по Interval мс за один проход, без промежуточных копий: Put(const _SeriesAggregate &) на каждый
+  // непустой интервал по порядку; возвращает число интервалов
+  template <typename F>
+  size_t aggregate(uint64_t Interval, F Put) const;
+};
+
+// Колоночное кольцо точек графика: смещения int32 (шаг 2^_scale мс) от базовой эпохи + значения float
+class _SeriesBuffer {
+private:
+  int32_t *_offsets = nullptr;
+  float   *_values  = nullptr;
+
+  uint64_t _base  = 0;
+  uint8_t  _scale = 0;
+
+  size_t _capacity = 0;
+  size_t _mask     = 0;
+  size_t _limit    = 0;
+  size_t _start    = 0;
+  size_t _size     = 0;
+
+  static const int32_t REBASE_MARGIN = 0x10000000;
+
+  static size_t _PowerOfTwo(size_t Size) {
+    size_t _result = 1;
+
+    while (_result < Size)
+      _result <<= 1;
+
+    return _result;
+  }
+
+  void _Destroy() {
+    psramFree(_offsets);
+    psramFree(_values);
+
+    _offsets = nullptr;
+    _values  = nullptr;
+  }
+
+  inline size_t _Index(size_t i) const {
+    return (_start + i) & _mask;
+  }
+
+  static bool _Overflow(uint64_t From, uint64_t To, uint8_t Scale) {
+    return ((To - From) >> Scale) >= static_cast<uint64_t>(INT32_MAX - REBASE_MARGIN);
+  }
+
+  // переносит базу на самую старую точку, чтобы смещения снова влезали в int32. Окно длиннее ~21 дня в мс не
+  // влезает - шаг смещений удваивается: точки остаются, у меток теряется точность до 2^_scale мс
+  void _Rebase(uint64_t Time) {
+    if (_size < 1) {
+      _base  = Time;
+      _scale = 0;
+      return;
+    }
+
+    const uint64_t _newBase = this->Time(0);
+
+    uint8_t _newScale = 0;
+
+    while (_Overflow(_newBase, Time, _newScale))
+      _newScale++;
+
+    for (size_t i = 0; i < _size; i++)
+      _offsets[_Index(i)] = static_cast<int32_t>((this->Time(i) - _newBase) >> _newScale);
+
+    _base  = _newBase;
+    _scale = _newScale;
+  }
+
+  int32_t _ToOffset(uint64_t Time) const {
+    return static_cast<int32_t>((Time - _base) >> _scale);
+  }
+
+public:
+  _SeriesBuffer() {
+  }
+
+  ~_SeriesBuffer() {
+    _Destroy();
+  }
+
+  bool setCapacity(size_t Size) {
+    if (Size == _limit)
+      return true;
+
+    if (Size < 1) {
+      _Destroy();
+
+      _capacity = _mask = _limit = _start = _size = 0;
+      return true;
+    }
+
+    size_t _newCapacity = _PowerOfTwo(Size);
+
+    if (_newCapacity == _capacity) {
+      _limit = Size;
+
+      while (_size > _limit)
+        removeFirst();
+
+      return true;
+    }
+
+    int32_t *_newOffsets = psramAlloc<int32_t>(_newCapacity);
+    float   *_newValues  = psramAlloc<float>(_newCapacity);
+
+    if (!_newOffsets || !_newValues) {
+      psramFree(_newOffsets);
+      psramFree(_newValues);
+
+      return false;
+    }
+
+    size_t _newSize = min(_size, Size);
+    size_t _skip    = _size - _newSize;
+
+    for (size_t i = 0; i < _newSize; i++) {
+      _newOffsets[i] = _offsets[_Index(_skip + i)];
+      _newValues[i]  = _values[_Index(_skip + i)];
+    }
+
+    _Destroy();
+
+    _offsets  = _newOffsets;
+    _values   = _newValues;
+    _capacity = _newCapacity;
+    _mask     = _newCapacity - 1;
+    _limit    = Size;
+    _start    = 0;
+    _size     = _newSize;
+
+    return true;
+  }
+
+  void clear() {
+    _start = 0;
+    _size  = 0;
+    _scale = 0;
+  }
+
+  void swap(_SeriesBuffer &Other) {
+    std::swap(_offsets, Other._offsets);
+    std::swap(_values, Other._values);
+    std::swap(_base, Other._base);
+    std::swap(_scale, Other._scale);
+    std::swap(_capacity, Other._capacity);
+    std::swap(_mask, Other._mask);
+    std::swap(_limit, Other._limit);
+    std::swap(_start, Other._start);
+    std::swap(_size, Other._size);
+  }
+
+  // копия Src (снимок для фоновой записи), ёмкость подгоняется под Src
+  bool assign(const _SeriesBuffer &Src) {
+    if (!setCapacity(Src._limit))
+      return false;
+
+    clear();
+
+    for (size_t i = 0; i < Src._size; i++) {
+      _offsets[i] = Src.Offset(i);
+      _values[i]  = Src.Value(i);
+    }
+
+    _base  = Src._base;
+    _scale = Src._scale;
+    _size  = Src._size;
+
+    return true;
+  }
+
+  bool append(uint64_t Time, float Value) {
+    if (_limit < 1)
+      return false;
+
+    if (_size < 1) {
+      _base  = Time;
+      _scale = 0;
+    }
+
+    if (Time < _base)
+      return false;
+
+    if (_Overflow(_base, Time, _scale))
+      _Rebase(Time);
+
+    if (_size >= _limit)
+      removeFirst();
+
+    const size_t _index = _Index(_size);
+
+    _offsets[_index] = _ToOffset(Time);
+    _values[_index]  = Value;
+
+    _size++;
+
+    return true;
+  }
+
+  bool setLast(uint64_t Time, float Value) {
+    if ((_size < 1) || (Time < _base))
+      return false;
+
+    if (_Overflow(_base, Time, _scale))
+      _Rebase(Time);
+
+    const size_t _index = _Index(_size - 1);
+
+    _offsets[_index] = _ToOffset(Time);
+    _values[_index]  = Value;
+
+    return true;
+  }
+
+  // сдвиг всех меток на Delta правкой базы: смещения относительные, точки не трогаются
+  void shift(uint64_t Delta) {
+    _base += Delta;
+  }
+
+  // сдвиг всех значений на Delta: смена поправки показаний
+  void shiftValues(float Delta) {
+    for (size_t i = 0; i < _size; i++)
+      _values[_Index(i)] += Delta;
+  }
+
+  void removeFirst() {
+    if (_size < 1)
+      return;
+
+    _start = (_start + 1) & _mask;
+    _size--;
+  }
+
+  // оставляет точки, для которых Keep(i) == true, порядок сохраняется; точки до From не трогаются
+  template <typename F>
+  void compact(F Keep, size_t From = 0) {
+    size_t _to = From;
+
+    for (size_t i = From; i < _size; i++) {
+      if (!Keep(i))
+        continue;
+
+      if (_to != i) {
+        _offsets[_Index(_to)] = _offsets[_Index(i)];
+        _values[_Index(_to)]  = _values[_Index(i)];
+      }
+
+      _to++;
+    }
+
+    _size = _to;
+  }
+
+  size_t size() const {
+    return _size;
+  }
+
+  size_t limit() const {
+    return _limit;
+  }
+
+  size_t capacity() const {
+    return _capacity;
+  }
+
+  size_t bytes() const {
+    return _capacity * (sizeof(int32_t) + sizeof(float));
+  }
+
+  uint64_t Base() const {
+    return _base;
+  }
+
+  // в шагах 2^_scale мс от Base(): для геометрии RDP и LTTB хватает пропорциональности времени
+  int32_t Offset(size_t i) const {
+    return _offsets[_Index(i)];
+  }
+
+  uint64_t Time(size_t i) const {
+    return _base + (static_cast<uint64_t>(static_cast<uint32_t>(_offsets[_Index(i)])) << _scale);
+  }
+
+  float Value(size_t i) const {
+    return _values[_Index(i)];
+  }
+
+  uint64_t LastTime() const {
+    return Time(_size - 1);
+  }
+
+  float LastValue() const {
+    return Value(_size - 1);
+  }
+
+  // первый индекс с Time(i) >= Time, точки упорядочены по времени
+  size_t lowerBound(uint64_t Time) const {
+    if ((_size < 1) || (Time <= _base))
+      return 0;
+
+    size_t _lo = 0;
+    size_t _hi = _size;
+
+    while (_lo < _hi) {
+      size_t _mid = (_lo + _hi) / 2;
+
+      if (this->Time(_mid) < Time)
+        _lo = _mid + 1;
+      else
+        _hi = _mid;
+    }
+
+    return _lo;
+  }
+
+  // точки с From <= Time < To
+  _SeriesView Range(uint64_t From, uint64_t To) const {
+    const size_t _first = lowerBound(From);
+    const size_t _last  = (To == UINT64_MAX) ? _size : lowerBound(To);
+
+    return _SeriesView(*this, _first, (_last > _first) ? _last - _first : 0);
+  }
+
+  _SeriesView Latest(size_t Count) const {
+    const size_t _count = min(Count, _size);
+
+    return _SeriesView(*this, _size - _count, _count);
+  }
+
+  _SeriesView All() const {
+    return _SeriesView(*this, 0, _size);
+  }
+
+  void exportTo(Table &Dest) const {
+    All().exportTo(Dest);
+  }
+};
+
+// Шкала времени ряда: до синхронизации RTC метки - millis() от старта, точки копятся без пропусков;
+// при первой синхронизации буфер переводится на unix мс сдвигом базы, без копирования
+class _SeriesClock {
+private:
+  bool _unix = false;
+
+public:
+  _SeriesClock() {
+  }
+
+  // false - шкала ещё millis(); при синхронизации сдвигает Buffer и отдаёт величину сдвига в Shift
+  bool sync(_SeriesBuffer &Buffer, uint64_t *Shift = nullptr) {
+    if (_unix)
+      return true;
+
+    if (!sett.rtc.synced())
+      return false;
+
+    const uint64_t _shift = sett.rtc.getUnixMs() - millis();
+
+    Buffer.shift(_shift);
+
+    if (Shift)
+      *Shift = _shift;
+
+    _unix = true;
+
+    return true;
+  }
+
+  bool IsUnix() const {
+    return _unix;
+  }
+
+  // текущее время в шкале ряда; 0 - RTC потеряла синхронизацию уже после перехода на unix
+  uint64_t Now() const {
+    if (!_unix)
+      return millis();
+
+    return sett.rtc.synced() ? sett.rtc.getUnixMs() : 0;
+  }
+
+  // отметка millis() в шкале ряда
+  uint64_t At(ulong Millis) const {
+    const uint64_t _now = Now();
+
+    return (_now > 0) ? _now - static_cast<ulong>(millis() - Millis) : 0;
+  }
+
+  // обратно: метка ряда -> millis()
+  ulong ToMillis(uint64_t Time) const {
+    return _unix ? UnixMsToMillis(Time) : static_cast<ulong>(Time);
+  }
+};
+
+inline uint64_t _SeriesView::Time(size_t i) const {
+  return _data->Time(_first + i);
+}
+
+inline float _SeriesView::Value(size_t i) const {
+  return _data->Value(_first + i);
+}
+
+inline int32_t _SeriesView::Offset(size_t i) const {
+  return _data->Offset(_first + i);
+}
+
+inline void _SeriesView::exportTo(Table &Dest) const {
+  Dest.removeAll();
+  Dest.reserve(_count);
+
+  for (size_t i = 0; i < _count; i++)
+    Dest.append(Time(i), Value(i));
+}
+
+template <typename F>
+size_t _SeriesView::aggregate(uint64_t Interval, F Put) const {
+  if (Interval < 1)
+    return 0;
+
+  _SeriesGrouper<F> _grouper(Interval, Put);
+
+  for (size_t i = 0; i < _count; i++)
+    _grouper.put(Time(i), Value(i));
+
+  return _grouper.finish();
+}
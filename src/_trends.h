@@ -0,0 +1,519 @@
+#pragma once
+
+#include "_common.h"
+#include "_persist.h"
+#include <rom/crc.h>
+
+#define TRENDS_FILE          "/trends.bin"
+#define TRENDS_MAGIC         0x31445254 // "TRD1"
+#define TRENDS_HOURS         48
+#define TRENDS_DAYS          62
+#define TRENDS_READINGS      6
+#define TRENDS_DEVICES       4
+#define TRENDS_SAMPLE_GAP    300000ul // дольше без показаний - последнее значение больше не держим
+#define TRENDS_SAVE_INTERVAL 600000ul // открытые интервалы - на флеш раз в 10 минут, закрытые - сразу
+#define TRENDS_SCALE         10000    // доли времени - в сотых долях процента
+#define TRENDS_PENDING       4        // закрытых интервалов уровня в памяти до подтверждения записи
+
+enum class _TrendLevel : uint8_t {
+  Hour = 0,
+  Day  = 1
+};
+
+// Показания канала за интервал: Covered - доля интервала с показаниями, Above/Below - доля покрытого времени
+// выше/ниже порогов; Count - число показаний (насыщается), 0 - канал молчал
+struct _TrendReading {
+  float    Min     = 0;
+  float    Max     = 0;
+  float    Avg     = 0;
+  uint16_t Covered = 0;
+  uint16_t Above   = 0;
+  uint16_t Below   = 0;
+  uint16_t Count   = 0;
+};
+
+// Слот файла: интервал целиком, с CRC. Duty - доля интервала, когда устройство было включено
+struct _TrendRecord {
+  uint32_t      From = 0; // unix, секунды; 0 - пустой слот
+  _TrendReading Readings[TRENDS_READINGS];
+  uint16_t      Duty[TRENDS_DEVICES] = {0};
+  uint32_t      Crc                  = 0;
+
+  void seal() {
+    Crc = crc32_le(0, reinterpret_cast<const uint8_t *>(this), offsetof(_TrendRecord, Crc));
+  }
+
+  bool valid() const {
+    return (From > 0) && (Crc == crc32_le(0, reinterpret_cast<const uint8_t *>(this), offsetof(_TrendRecord, Crc)));
+  }
+};
+
+struct _TrendHeader {
+  uint32_t Magic = TRENDS_MAGIC;
+  uint16_t Hours = TRENDS_HOURS;
+  uint16_t Days  = TRENDS_DAYS;
+};
+
+static_assert(sizeof(_TrendRecord) == 136, "_TrendRecord layout is part of the file format");
+
+// Накопитель канала за интервал: каждое значение держится до следующего показания, но не дольше TRENDS_SAMPLE_GAP
+struct _TrendAccum {
+  float    Min     = 0;
+  float    Max     = 0;
+  double   Sum     = 0;
+  uint32_t Ms      = 0;
+  uint32_t AboveMs = 0;
+  uint32_t BelowMs = 0;
+  uint32_t Count   = 0;
+
+  static uint16_t scale(uint64_t Part, uint64_t Whole) {
+    return (Whole > 0) ? static_cast<uint16_t>(min(Part * TRENDS_SCALE / Whole, (uint64_t)TRENDS_SCALE)) : 0;
+  }
+
+  static uint32_t unscale(uint16_t Part, uint64_t Whole) {
+    return static_cast<uint32_t>(Part * Whole / TRENDS_SCALE);
+  }
+
+  void range(float Value) {
+    Min = (Count > 0) ? min(Min, Value) : Value;
+    Max = (Count > 0) ? max(Max, Value) : Value;
+  }
+
+  void hold(float Value, uint32_t Duration, float Low, float High) {
+    Sum += static_cast<double>(Value) * Duration;
+    Ms += Duration;
+
+    if (!std::isnan(High) && (Value > High))
+      AboveMs += Duration;
+    if (!std::isnan(Low) && (Value < Low))
+      BelowMs += Duration;
+  }
+
+  void take(_TrendReading &Reading, uint64_t Length) const {
+    Reading = _TrendReading();
+
+    if (Count < 1)
+      return;
+
+    Reading.Min     = Min;
+    Reading.Max     = Max;
+    Reading.Avg     = (Ms > 0) ? static_cast<float>(Sum / Ms) : (Min + Max) / 2;
+    Reading.Covered = scale(Ms, Length);
+    Reading.Above   = scale(AboveMs, Ms);
+    Reading.Below   = scale(BelowMs, Ms);
+    Reading.Count   = min(Count, (uint32_t)UINT16_MAX);
+  }
+
+  // продолжение интервала, начатого до перезагрузки
+  void resume(const _TrendReading &Reading, uint64_t Length) {
+    *this = _TrendAccum();
+
+    if (Reading.Count < 1)
+      return;
+
+    Min     = Reading.Min;
+    Max     = Reading.Max;
+    Ms      = unscale(Reading.Covered, Length);
+    Sum     = static_cast<double>(Reading.Avg) * Ms;
+    AboveMs = unscale(Reading.Above, Ms);
+    BelowMs = unscale(Reading.Below, Ms);
+    Count   = Reading.Count;
+  }
+};
+
+// Часовые и суточные итоги по показаниям и устройствам, считаются на лету. Файл фиксированного размера:
+// заголовок, TRENDS_HOURS часовых и TRENDS_DAYS суточных слотов, слот = (начало / длина) % число слотов.
+// Интервалы - по UTC, пока RTC не синхронизирована, ничего не считается
+class _Trends : public _Persistent {
+private:
+  struct _Channel {
+    float       Low      = NAN;
+    float       High     = NAN;
+    float       Last     = 0;
+    uint64_t    SampleMs = 0; // 0 - показаний ещё не было
+    uint64_t    HeldMs   = 0;
+    _TrendAccum Accum[2];
+  };
+
+  struct _Device {
+    bool     On      = false;
+    uint64_t SinceMs = 0;
+    uint32_t OnMs[2] = {0, 0};
+  };
+
+  struct _Slot {
+    size_t       Offset = 0;
+    int8_t       Closed = -1; // уровень закрытого интервала, -1 - открытый
+    _TrendRecord Record;
+  };
+
+  _Channel _channels[TRENDS_READINGS];
+  _Device  _devices[TRENDS_DEVICES];
+
+  uint64_t _from[2] = {0, 0}; // начало открытых интервалов, мс
+
+  // закрытые интервалы, ещё не подтверждённые записью, от старых к новым
+  _TrendRecord _closed[2][TRENDS_PENDING];
+  size_t       _closedCount[2] = {0, 0};
+
+  // снимок для задачи persist: закрытые + открытые интервалы; _saved - задача записала его целиком
+  _Slot         _snapshot[2 * (TRENDS_PENDING + 1)];
+  size_t        _snapshotCount = 0;
+  volatile bool _saved         = false;
+
+  bool  _resumed    = false;
+  bool  _changed    = false;
+  ulong _saveMillis = 0;
+
+  static uint64_t _Length(uint8_t Level) {
+    return (Level == static_cast<uint8_t>(_TrendLevel::Hour)) ? 3600000ull : 86400000ull;
+  }
+
+  static size_t _Slots(uint8_t Level) {
+    return (Level == static_cast<uint8_t>(_TrendLevel::Hour)) ? TRENDS_HOURS : TRENDS_DAYS;
+  }
+
+  static size_t _Offset(uint8_t Level, uint64_t FromMs) {
+    size_t _offset = sizeof(_TrendHeader);
+
+    if (Level == static_cast<uint8_t>(_TrendLevel::Day))
+      _offset += TRENDS_HOURS * sizeof(_TrendRecord);
+
+    return _offset + ((FromMs / _Length(Level)) % _Slots(Level)) * sizeof(_TrendRecord);
+  }
+
+  static size_t _FileSize() {
+    return sizeof(_TrendHeader) + (TRENDS_HOURS + TRENDS_DAYS) * sizeof(_TrendRecord);
+  }
+
+  // время с прошлого учёта - в накопители всех уровней
+  void _Account(uint64_t ToMs) {
+    for (_Channel &_channel : _channels) {
+      if (_channel.SampleMs == 0)
+        continue;
+
+      const uint64_t _until = min(ToMs, _channel.SampleMs + TRENDS_SAMPLE_GAP);
+
+      if (_until > _channel.HeldMs) {
+        for (_TrendAccum &_accum : _channel.Accum)
+          _accum.hold(_channel.Last, _until - _channel.HeldMs, _channel.Low, _channel.High);
+
+        _channel.HeldMs = _until;
+      }
+    }
+
+    for (_Device &_device : _devices) {
+      if (_device.On && (ToMs > _device.SinceMs)) {
+        for (uint32_t &_onMs : _device.OnMs)
+          _onMs += ToMs - _device.SinceMs;
+      }
+
+      _device.SinceMs = max(_device.SinceMs, ToMs);
+    }
+  }
+
+  void _Record(uint8_t Level, _TrendRecord &Record) const {
+    const uint64_t _length = _Length(Level);
+
+    Record      = _TrendRecord();
+    Record.From = _from[Level] / 1000;
+
+    for (size_t i = 0; i < TRENDS_READINGS; i++)
+      _channels[i].Accum[Level].take(Record.Readings[i], _length);
+
+    for (size_t i = 0; i < TRENDS_DEVICES; i++)
+      Record.Duty[i] = _TrendAccum::scale(_devices[i].OnMs[Level], _length);
+
+    Record.seal();
+  }
+
+  bool _Read(uint8_t Level, uint64_t FromMs, _TrendRecord &Record) const {
+    File f = LittleFS.open(TRENDS_FILE, FILE_READ);
+    if (!f)
+      return false;
+
+    bool _ok = (f.size() == _FileSize()) &&
+               f.seek(_Offset(Level, FromMs)) &&
+               (f.read(reinterpret_cast<uint8_t *>(&Record), sizeof(Record)) == sizeof(Record));
+
+    f.close();
+
+    return _ok && Record.valid() && (Record.From == FromMs / 1000);
+  }
+
+  // интервал, открытый до перезагрузки, продолжаем с сохранённых итогов
+  void _Resume(uint8_t Level) {
+    _TrendRecord _record;
+
+    if (!_FS_Initialized || !_Read(Level, _from[Level], _record))
+      return;
+
+    for (size_t i = 0; i < TRENDS_READINGS; i++)
+      _channels[i].Accum[Level].resume(_record.Readings[i], _Length(Level));
+
+    for (size_t i = 0; i < TRENDS_DEVICES; i++)
+      _devices[i].OnMs[Level] = _TrendAccum::unscale(_record.Duty[i], _Length(Level));
+  }
+
+  void _Forget(uint8_t Level, size_t Index) {
+    for (size_t i = Index + 1; i < _closedCount[Level]; i++)
+      _closed[Level][i - 1] = _closed[Level][i];
+
+    _closedCount[Level]--;
+  }
+
+  // loop: снимок записан - закрытые интервалы из него больше не держим
+  void _Acknowledge() {
+    if (IsBusy() || !_saved)
+      return;
+
+    _saved = false;
+
+    for (size_t i = 0; i < _snapshotCount; i++) {
+      const int8_t _level = _snapshot[i].Closed;
+
+      if (_level < 0)
+        continue;
+
+      for (size_t j = 0; j < _closedCount[_level]; j++) {
+        if (_closed[_level][j].From == _snapshot[i].Record.From) {
+          _Forget(_level, j);
+          break;
+        }
+      }
+    }
+  }
+
+  const _TrendRecord *_Pending(uint8_t Level, uint32_t From) const {
+    for (size_t i = 0; i < _closedCount[Level]; i++) {
+      if (_closed[Level][i].From == From)
+        return &_closed[Level][i];
+    }
+
+    return nullptr;
+  }
+
+  // флеш недоступен дольше TRENDS_PENDING интервалов - теряем самый старый
+  void _Close(uint8_t Level) {
+    if (_closedCount[Level] >= TRENDS_PENDING) {
+      debug.tprintf("%s: interval %u lost\n", TRENDS_FILE, (uint)_closed[Level][0].From);
+
+      _Forget(Level, 0);
+    }
+
+    _Record(Level, _closed[Level][_closedCount[Level]++]);
+
+    for (_Channel &_channel : _channels)
+      _channel.Accum[Level] = _TrendAccum();
+
+    for (_Device &_device : _devices)
+      _device.OnMs[Level] = 0;
+
+    markDirty();
+  }
+
+  // переход через границу часа/суток: учёт до границы, закрытие, новый интервал
+  bool _Roll() {
+    if (!sett.rtc.synced())
+      return false;
+
+    const uint64_t _now = sett.rtc.getUnixMs();
+
+    for (uint8_t _level = 0; _level < 2; _level++) {
+      const uint64_t _start = _now - _now % _Length(_level);
+
+      if (_from[_level] == _start)
+        continue;
+
+      if (_from[_level] > 0) {
+        _Account(_from[_level] + _Length(_level));
+        _Close(_level);
+      }
+
+      _from[_level] = _start;
+
+      if (!_resumed)
+        _Resume(_level);
+    }
+
+    _resumed = true;
+
+    _Account(_now);
+
+    return true;
+  }
+
+public:
+  _Trends() {
+  }
+
+  // пороги канала для Above/Below, NAN - порога нет
+  void setThresholds(size_t Channel, float Low, float High) {
+    if (Channel >= TRENDS_READINGS)
+      return;
+
+    _channels[Channel].Low  = Low;
+    _channels[Channel].High = High;
+  }
+
+  void sample(size_t Channel, float Value) {
+    if ((Channel >= TRENDS_READINGS) || !std::isfinite(Value) || !_Roll())
+      return;
+
+    _Channel &_channel = _channels[Channel];
+
+    _channel.Last     = Value;
+    _channel.SampleMs = _channel.HeldMs = sett.rtc.getUnixMs();
+
+    for (_TrendAccum &_accum : _channel.Accum) {
+      _accum.range(Value);
+      _accum.Count++;
+    }
+
+    _changed = true;
+  }
+
+  void event(size_t Device, bool On) {
+    if ((Device >= TRENDS_DEVICES) || !_Roll())
+      return;
+
+    _devices[Device].On = On;
+
+    _changed = true;
+  }
+
+  // открытые интервалы - на флеш раз в TRENDS_SAVE_INTERVAL, если что-то пришло
+  void Tick() {
+    if (!_Roll())
+      return;
+
+    if (_changed && ((millis() - _saveMillis) >= TRENDS_SAVE_INTERVAL)) {
+      _saveMillis = millis();
+      _changed    = false;
+
+      markDirty();
+    }
+  }
+
+  // записи уровня с FromMs по возрастанию, последняя - открытый интервал: Put(const _TrendRecord &).
+  // Читается по слоту на интервал, без обхода всего файла
+  template <typename F>
+  size_t forEach(_TrendLevel Level, uint64_t FromMs, F Put) const {
+    const uint8_t _level = static_cast<uint8_t>(Level);
+
+    if (_from[_level] == 0)
+      return 0;
+
+    const uint64_t _length = _Length(_level);
+    const uint64_t _oldest = _from[_level] - min(_from[_level], (_Slots(_level) - 1) * _length);
+
+    uint64_t _start = max(FromMs - FromMs % _length, _oldest);
+    size_t   _count = 0;
+
+    _TrendRecord _record;
+
+    for (; _start < _from[_level]; _start += _length) {
+      // закрытый, но ещё не записанный интервал - из памяти, в файле на его месте старый
+      const _TrendRecord *_pending = _Pending(_level, _start / 1000);
+
+      if (_pending)
+        _record = *_pending;
+      else if (!_FS_Initialized || !_Read(_level, _start, _record))
+        continue;
+
+      Put(_record);
+      _count++;
+    }
+
+    _Record(_level, _record);
+
+    Put(_record);
+
+    return _count + 1;
+  }
+
+  // закрытый интервал уходит в каждый снимок, пока Flush() его не запишет
+  bool IsDirty() override {
+    _Acknowledge();
+
+    return _Persistent::IsDirty() || (_closedCount[0] > 0) || (_closedCount[1] > 0);
+  }
+
+  bool Snapshot() override {
+    _Acknowledge();
+
+    _snapshotCount = 0;
+    _saved         = false;
+
+    for (uint8_t _level = 0; _level < 2; _level++) {
+      for (size_t i = 0; i < _closedCount[_level]; i++) {
+        _snapshot[_snapshotCount].Offset = _Offset(_level, static_cast<uint64_t>(_closed[_level][i].From) * 1000);
+        _snapshot[_snapshotCount].Closed = _level;
+        _snapshot[_snapshotCount].Record = _closed[_level][i];
+        _snapshotCount++;
+      }
+
+      if (_from[_level] > 0) {
+        _snapshot[_snapshotCount].Offset = _Offset(_level, _from[_level]);
+        _snapshot[_snapshotCount].Closed = -1;
+        _Record(_level, _snapshot[_snapshotCount].Record);
+        _snapshotCount++;
+      }
+    }
+
+    return _snapshotCount > 0;
+  }
+
+  // файл создаётся целиком один раз, дальше переписываются только слоты
+  bool Flush() override {
+    File f = LittleFS.open(TRENDS_FILE, FILE_READ);
+
+    const bool _fresh = !f || (f.size() != _FileSize());
+
+    if (f)
+      f.close();
+
+    if (_fresh) {
+      f = LittleFS.open(TRENDS_FILE, FILE_WRITE);
+      if (!f)
+        return false;
+
+      _TrendHeader _header;
+      _TrendRecord _empty;
+
+      bool _ok = (written(f.write(reinterpret_cast<const uint8_t *>(&_header), sizeof(_header))) == sizeof(_header));
+
+      for (size_t i = 0; _ok && (i < TRENDS_HOURS + TRENDS_DAYS); i++)
+        _ok = (written(f.write(reinterpret_cast<const uint8_t *>(&_empty), sizeof(_empty))) == sizeof(_empty));
+
+      f.close();
+
+      if (!_ok)
+        return false;
+    }
+
+    f = LittleFS.open(TRENDS_FILE, "r+");
+    if (!f)
+      return false;
+
+    bool _ok = true;
+
+    for (size_t i = 0; _ok && (i < _snapshotCount); i++) {
+      _ok = f.seek(_snapshot[i].Offset) &&
+            (written(f.write(reinterpret_cast<const uint8_t *>(&_snapshot[i].Record), sizeof(_TrendRecord))) == sizeof(_TrendRecord));
+    }
+
+    f.close();
+
+    // подтверждаем только после close(): до него LittleFS данные не фиксирует
+    _saved = _ok;
+
+    return _ok;
+  }
+
+  const char *PersistName() override {
+    return TRENDS_FILE;
+  }
+};
+
+_Trends trends;
@@ -1,13 +1,17 @@
 #include "_alerts.h"
+#include "_blackbox.h"
+#include "_boot.h"
 #include "_common.h"
 #include "_controller.h"
 #include "_devices.h"
+#include "_flashlog.h"
 #include "_greenhouse.h"
 #include "_params_state.h"
 #include "_rdp.h"
 #include "_sensors.h"
+#include "_trends.h"
 
-_Plot p(_SubType::Humidity);
+_PlotList Plots;
 
 _ParamState<bool> Params;
 
@@ -24,10 +28,21 @@ struct _localParams {
 
 _localParams localParams;
 
+// датчика нет или он не отвечает - точку не ставим, иначе на графике нули
+inline void PlotUpdate(_Plot &Plot, _SensorCustom &Sensor, _Readings &Readings) {
+  if (Sensor.IsValid())
+    Plot.putValue(Readings.Value());
+}
+
 inline void WebUpdate() {
   // debug.tprintln("WebUpdate()");
 
-  p.putValue(GreenHouse.Sensors.dht22in.Humidity.Value());
+  PlotUpdate(Plots.TemperatureIn, GreenHouse.Sensors.dht22in, GreenHouse.Sensors.dht22in.Temperature);
+  PlotUpdate(Plots.HumidityIn, GreenHouse.Sensors.dht22in, GreenHouse.Sensors.dht22in.Humidity);
+  PlotUpdate(Plots.CO2In, GreenHouse.Sensors.mhz19in, GreenHouse.Sensors.mhz19in.CO2);
+  PlotUpdate(Plots.TemperatureOut, GreenHouse.Sensors.dht22out, GreenHouse.Sensors.dht22out.Temperature);
+  PlotUpdate(Plots.HumidityOut, GreenHouse.Sensors.dht22out, GreenHouse.Sensors.dht22out.Humidity);
+  PlotUpdate(Plots.CO2Out, GreenHouse.Sensors.mhz19out, GreenHouse.Sensors.mhz19out.CO2);
 
   sett.updater()
       .update(dbParams::TemperatureIn, GreenHouse.Sensors.dht22in.Temperature.Text())
@@ -42,20 +57,20 @@ inline void WebUpdate() {
       .update(dbParams::FanInnerLED, GreenHouse.Devices.FanInner.State())
       .update(H(log), logger);
 
-  if (!db[TemperatureModeIn].toBool()) {
-    sett.updater().updatePlot<float>(dbParams::TemperaturePlotIn, {GreenHouse.Sensors.dht22in.Temperature.Value()});
+  if (!db[TemperatureModeIn].toBool() && Plots.TemperatureIn.HasDelta()) {
+    sett.updater().updatePlot(dbParams::TemperaturePlotIn, Plots.TemperatureIn.Delta(), true);
   }
 
   // if (!db[HumidityModeIn].toBool()) {
   //   sett.updater().updatePlot<float>(dbParams::HumidityPlotIn, {GreenHouse.Sensors.dht22in.Humidity.Value()});
   // }
 
-  if (!db[HumidityModeIn].toBool()) {
-    sett.updater().updatePlot(dbParams::HumidityPlotIn, p.Point(), true);
+  if (!db[HumidityModeIn].toBool() && Plots.HumidityIn.HasDelta()) {
+    sett.updater().updatePlot(dbParams::HumidityPlotIn, Plots.HumidityIn.Delta(), true);
   }
 
-  if (!db[CO2ModeIn].toBool()) {
-    sett.updater().updatePlot<float>(dbParams::CO2PlotIn, {GreenHouse.Sensors.mhz19in.CO2.Value()});
+  if (!db[CO2ModeIn].toBool() && Plots.CO2In.HasDelta()) {
+    sett.updater().updatePlot(dbParams::CO2PlotIn, Plots.CO2In.Delta(), true);
   }
 
   if (GreenHouse.Sync.SubTypeIs(_SubType::Temperature))
@@ -98,9 +113,20 @@ inline void WebUpdate() {
   }
 }
 
+// пороги тревог - границы Above/Below в итогах, снаружи те же, что внутри
+inline void TrendsThresholds() {
+  for (size_t i = 0; i < 2; i++) {
+    trends.setThresholds(i * 3 + 0, db[TemperatureAlarmThresholdLow].toFloat(), db[TemperatureAlarmThresholdHigh].toFloat());
+    trends.setThresholds(i * 3 + 1, db[HumidityAlarmThresholdLow].toFloat(), db[HumidityAlarmThresholdHigh].toFloat());
+    trends.setThresholds(i * 3 + 2, NAN, db[CO2AlarmThresholdHigh].toFloat());
+  }
+}
+
 inline void AlertsUpdate() {
   //  debug.tprintln("AlertsUpdate()");
 
+  TrendsThresholds();
+
   _Alert &Temperature = GreenHouse.Alerts.Temperature;
   _Alert &Humidity    = GreenHouse.Alerts.Humidity;
   _Alert &CO2         = GreenHouse.Alerts.CO2;
@@ -371,11 +397,17 @@ inline void AlertsUpdate() {
   TemperatureIn.setStatEnabled(&Temperature, Temperature.StateIs({_AlertState::Low, _AlertState::High}));
   HumidityIn.setStatEnabled(&Humidity, Humidity.StateIs({_AlertState::Low, _AlertState::High}));
   CO2In.setStatEnabled(&CO2, CO2.StateIs(_AlertState::High));
+
+  Temperature.setTrace(TemperatureIn.takeSampleMicros());
+  Humidity.setTrace(HumidityIn.takeSampleMicros());
+  CO2.setTrace(CO2In.takeSampleMicros());
 }
 
 inline void DevicesUpdate() {
   //  debug.tprintln("DevicesUpdate()");
 
+  boot.mark("regulating");
+
   _Device &FanMain    = GreenHouse.Devices.FanMain;
   _Device &FanInner   = GreenHouse.Devices.FanInner;
   _Device &Humidifier = GreenHouse.Devices.Humidifier;
@@ -397,6 +429,8 @@ inline void DevicesUpdate() {
   float _midHumidity    = (db[HumidityAlarmThresholdHigh].toInt() + db[HumidityAlarmThresholdLow].toInt()) / 2;
   float _midCO2         = db[CO2AlarmThresholdHigh].toInt();
 
+  GreenHouse.Devices.setTrace(Temperature.Trace);
+
   switch (Temperature.State()) {
     case _AlertState::High:
       FanInner.Start(&Temperature);
@@ -428,6 +462,8 @@ inline void DevicesUpdate() {
       FanInner.Stop(&Temperature);
   }
 
+  GreenHouse.Devices.setTrace(Humidity.Trace);
+
   switch (Humidity.State()) {
     case _AlertState::High:
       FanInner.Start(&Humidity);
@@ -482,6 +518,8 @@ inline void DevicesUpdate() {
       FanInner.Stop(&Humidity);
   }
 
+  GreenHouse.Devices.setTrace(CO2.Trace);
+
   switch (CO2.State()) {
     case _AlertState::High:
       FanInner.Start(&CO2);
@@ -500,6 +538,8 @@ inline void DevicesUpdate() {
       FanMain.Stop(&CO2);
       FanInner.Stop(&CO2);
   }
+
+  GreenHouse.Devices.clearTrace();
 }
 
 inline void WebAction(const size_t Param, const Text Value) {
@@ -524,6 +564,7 @@ inline void WebAction(const size_t Param, const Text Value) {
 
     case dbParams::SensorScanDelay:
       GreenHouse.setSensorUpdateInterval(Value.toInt() * 1000ul);
+      blackbox.setSampleInterval(Value.toInt() * 1000ul);
       break;
 
     case dbParams::TemperatureInStackSize:
@@ -589,9 +630,48 @@ inline void WebAction(const size_t Param, const Text Value) {
     case dbParams::CO2OutAutoCalibration:
       // GreenHouse.Sensors.mhz19out.setAutoCalibration(Value.toBool());
       break;
+
+    case dbParams::TemperaturePlotInEpsilon:
+      Plots.TemperatureIn.setEpsilon(Value.toFloat());
+      break;
+
+    case dbParams::HumidityPlotInEpsilon:
+      Plots.HumidityIn.setEpsilon(Value.toFloat());
+      break;
+
+    case dbParams::CO2PlotInEpsilon:
+      Plots.CO2In.setEpsilon(Value.toFloat());
+      break;
+
+    case dbParams::TemperaturePlotOutEpsilon:
+      Plots.TemperatureOut.setEpsilon(Value.toFloat());
+      break;
+
+    case dbParams::HumidityPlotOutEpsilon:
+      Plots.HumidityOut.setEpsilon(Value.toFloat());
+      break;
+
+    case dbParams::CO2PlotOutEpsilon:
+      Plots.CO2Out.setEpsilon(Value.toFloat());
+      break;
+
+    case dbParams::PlotEpsilonAdaptive:
+    case dbParams::PlotPointsPerHour:
+      Plots.setTargetRate(db[PlotEpsilonAdaptive].toBool() ? db[PlotPointsPerHour].toInt() : 0);
+      break;
   }
 }
 
+// WebBuild идёт и на проходах действия, где график не отправляется: курсор дельт - только на построении
+inline Table &PlotView(sets::Builder &b, _Plot &Plot) {
+  Table &table = Plot.View(PLOT_VIEW_POINTS);
+
+  if (!b.build.isAction())
+    Plot.setSent();
+
+  return table;
+}
+
 // 💧⚙️💭💦♨♨️🌀🛠️🔗🌡️🛠🌡💨✇☢🌫⏱️⏱🕒⏲️⌛⏳↺↻⚠⚠️
 inline void WebBuild(sets::Builder &b) {
   debug.tprintln("WebBuild()");
@@ -611,7 +691,7 @@ inline void WebBuild(sets::Builder &b) {
     }
 
     if (!db[TemperatureModeIn].toBool()) {
-      b.PlotRunning(dbParams::TemperaturePlotIn, "°C", db[SensorScanDelay].toInt());
+      b.Plot(dbParams::TemperaturePlotIn, PlotView(b, Plots.TemperatureIn), "°C", false);
     }
 
     if (b.beginRow("")) {
@@ -626,7 +706,7 @@ inline void WebBuild(sets::Builder &b) {
     if (!db[HumidityModeIn].toBool()) {
       //      b.PlotRunning(dbParams::HumidityPlotIn, "%", db[SensorScanDelay].toInt());
 
-      b.Plot(dbParams::HumidityPlotIn, p.Data(), "%", false);
+      b.Plot(dbParams::HumidityPlotIn, PlotView(b, Plots.HumidityIn), "%", false);
     }
 
     if (b.beginRow("")) {
@@ -639,7 +719,7 @@ inline void WebBuild(sets::Builder &b) {
     }
 
     if (!db[CO2ModeIn].toBool()) {
-      b.PlotRunning(dbParams::CO2PlotIn, "ppm", db[SensorScanDelay].toInt());
+      b.Plot(dbParams::CO2PlotIn, PlotView(b, Plots.CO2In), "ppm", false);
     }
 
     b.endGroup();
@@ -900,6 +980,30 @@ inline void WebBuild(sets::Builder &b) {
       b.endMenu();
     }
 
+    if (b.beginMenu("📈 Графики")) {
+      if (b.beginGroup("Точность внутри")) {
+        b.Number(dbParams::TemperaturePlotInEpsilon, "🌡️ °C", nullptr, 0, 10);
+        b.Number(dbParams::HumidityPlotInEpsilon, "💧 %", nullptr, 0, 10);
+        b.Number(dbParams::CO2PlotInEpsilon, "💭 ppm", nullptr, 0, 500);
+        b.endGroup();
+      }
+
+      if (b.beginGroup("Точность снаружи")) {
+        b.Number(dbParams::TemperaturePlotOutEpsilon, "🌡️ °C", nullptr, 0, 10);
+        b.Number(dbParams::HumidityPlotOutEpsilon, "💧 %", nullptr, 0, 10);
+        b.Number(dbParams::CO2PlotOutEpsilon, "💭 ppm", nullptr, 0, 500);
+        b.endGroup();
+      }
+
+      if (b.beginGroup("Адаптивная точность")) {
+        b.Switch(dbParams::PlotEpsilonAdaptive, "Подстраивать");
+        b.Slider(dbParams::PlotPointsPerHour, "Точек в час", 6, 600, 6);
+        b.endGroup();
+      }
+
+      b.endMenu();
+    }
+
     if (b.beginMenu("📊 Информация")) {
       if (b.beginGroup("Лог")) {
         b.Log(H(log), logger);
@@ -991,6 +1095,144 @@ inline void WebBuild(sets::Builder &b) {
         sett.updater().update(H(log), logger);
       }
 
+      if (b.Button("Задержки")) {
+        std::vector<std::reference_wrapper<_Latency>> r = {
+            GreenHouse.Latency.Temperature,
+            GreenHouse.Latency.Humidity,
+            GreenHouse.Latency.CO2};
+
+        std::vector<std::pair<const char *, _LatencyHistogram _Latency::*>> h = {
+            {"SampleToDecision", &_Latency::SampleToDecision},
+            {"DecisionToRelay", &_Latency::DecisionToRelay},
+            {"SampleToRelay", &_Latency::SampleToRelay}};
+
+        logger.clear();
+
+        for (auto &latency_ref : r) {
+          _Latency &latency = latency_ref.get();
+
+          logger.printf("=== %s ===\n", latency.Name());
+
+          for (auto &hist_ref : h) {
+            _LatencyHistogram &hist = latency.*hist_ref.second;
+
+            logger.printf("%s: count %lu, min %lu, avg %lu, p50 %lu, p95 %lu, p99 %lu, max %lu us\n",
+                          hist_ref.first,
+                          (ulong)hist.Count(),
+                          hist.Min(),
+                          hist.Avg(),
+                          hist.Percentile(50),
+                          hist.Percentile(95),
+                          hist.Percentile(99),
+                          hist.Max());
+          }
+        }
+
+        sett.updater().update(H(log), logger);
+      }
+
+      if (b.Button("Сбросить задержки")) {
+        GreenHouse.Latency.clear();
+      }
+
+      if (b.Button("Загрузка")) {
+        logger.clear();
+
+        boot.print(logger);
+
+        sett.updater().update(H(log), logger);
+      }
+
+      if (b.Button("Запись на флеш")) {
+        logger.clear();
+
+        logger.printf("persist task: %s, window %lu s, %llu B, %llu B/h\n",
+                      persist.IsRunning() ? "running" : "off",
+                      persist.Window() / 1000ul,
+                      persist.Bytes(),
+                      persist.BytesPerHour());
+        logger.printf("flash log: %s, %u / %u records, erases %lu, fails %lu, dropped %lu\n",
+                      flashlog.IsReady() ? "ready" : "off",
+                      (uint)flashlog.Records(),
+                      (uint)flashlog.Capacity(),
+                      flashlog.Erases(),
+                      flashlog.Fails(),
+                      flashlog.Dropped());
+        logger.printf("black box: %s, %u / %u records (~%u h), erases %lu, fails %lu, dropped %lu\n",
+                      blackbox.IsReady() ? "ready" : "off",
+                      (uint)blackbox.Records(),
+                      (uint)blackbox.Capacity(),
+                      (uint)blackbox.Hours(),
+                      blackbox.Erases(),
+                      blackbox.Fails(),
+                      blackbox.Dropped());
+
+        for (size_t i = 0; i < persist.Count(); i++) {
+          _Persistent &item = persist.Item(i);
+
+          logger.printf("%s: count %lu, fails %lu, %llu B, last %lu, avg %lu, max %lu us\n",
+                        item.PersistName(),
+                        item.FlushStat.Count,
+                        item.FlushStat.Fails,
+                        item.FlushStat.Bytes,
+                        item.FlushStat.LastMicros,
+                        item.FlushStat.AvgMicros(),
+                        item.FlushStat.MaxMicros);
+        }
+
+        sett.updater().update(H(log), logger);
+      }
+
+      if (b.Button("Агрегаты")) {
+        logger.clear();
+
+        auto print = [](const _SeriesAggregate &group) {
+          logger.printf("  %llu: n %lu, min %.2f, max %.2f, avg %.2f, first %.2f, last %.2f\n",
+                        group.From / 1000ull,
+                        (ulong)group.Count,
+                        group.Min,
+                        group.Max,
+                        group.Avg(),
+                        group.First,
+                        group.Last);
+        };
+
+        logger.printf("%s, 1 h:\n", Plots.TemperatureIn.PersistName());
+        Plots.TemperatureIn.Aggregate(0, UINT64_MAX, 3600000ull, print);
+
+        logger.println("dht22in.Temperature.History, 1 min:");
+        GreenHouse.Sensors.dht22in.Temperature.History.Aggregate(0, UINT64_MAX, 60000ull, print);
+
+        sett.updater().update(H(log), logger);
+      }
+
+      if (b.Button("Итоги")) {
+        logger.clear();
+
+        auto print = [](const _TrendRecord &record) {
+          const _TrendReading &t = record.Readings[0];
+          const _TrendReading &h = record.Readings[1];
+          const _TrendReading &c = record.Readings[2];
+
+          logger.printf("  %lu: t %.1f..%.1f avg %.1f >%u%% <%u%%, h avg %.0f, co2 avg %.0f, heat %u%%, wet %u%%\n",
+                        (ulong)record.From,
+                        t.Min,
+                        t.Max,
+                        t.Avg,
+                        t.Above / 100,
+                        t.Below / 100,
+                        h.Avg,
+                        c.Avg,
+                        record.Duty[3] / 100,
+                        record.Duty[2] / 100);
+        };
+
+        logger.println("trends, days:");
+        trends.forEach(_TrendLevel::Day, 0, print);
+
+        sett.updater().update(H(log), logger);
+      }
+
       if (b.Button("История, стек")) {
         logger.clear();
 
@@ -1195,6 +1437,8 @@ inline void WebBuild(sets::Builder &b) {
 
   if (b.Confirm(dbParams::RestartConfirm, "Перезагрузить контроллер?")) {
     if (b.build.value.toBool()) {
+      persist.Sync();
+
       ESP.restart();
     }
   }
@@ -1274,6 +1518,28 @@ inline void WebBuild(sets::Builder &b) {
   }
 }
 
+inline void PlotArchive(_Plot &Plot, uint64_t UnixMs, float Value) {
+  flashlog.append(Plots.Channel(Plot), UnixMs, Value);
+}
+
+// источник в самописце и итогах - номер канала графика тех же показаний
+inline void ReadingsSample(_Readings &Readings, float Value) {
+  const _Readings *channels[] = {&GreenHouse.Sensors.dht22in.Temperature,
+                                 &GreenHouse.Sensors.dht22in.Humidity,
+                                 &GreenHouse.Sensors.mhz19in.CO2,
+                                 &GreenHouse.Sensors.dht22out.Temperature,
+                                 &GreenHouse.Sensors.dht22out.Humidity,
+                                 &GreenHouse.Sensors.mhz19out.CO2};
+
+  for (size_t i = 0; i < sizeof(channels) / sizeof(channels[0]); i++) {
+    if (channels[i] != &Readings)
+      continue;
+
+    blackbox.sample(i, Value);
+    trends.sample(i, Value);
+  }
+}
+
 inline void AlertStateChanged(_Alert &Alert, _AlertState StateFrom, _AlertState StateTo) {
   // debug.tprintf("%s.AlertStateChanged: %s > %s\n",
   //               Type.Name(),
@@ -1287,6 +1553,11 @@ inline void DeviceActiveChanged(_Device &Device, bool IsActive) {
 
 inline void DeviceStateChanged(_Device &Device, bool State) {
   //  debug.tprintf("%s.%s\n", Device.Name(), State ? "TurnOn()" : "TurnOff()");
+
+  blackbox.event(static_cast<uint8_t>(Device.SubType()), State);
+
+  // FanMain, FanInner, Humidifier, Heater - подряд в _SubType
+  trends.event(static_cast<size_t>(Device.SubType()) - static_cast<size_t>(_SubType::FanMain), State);
 }
 
 inline void StatDirectionChange(_ReadingsStat &Stat, float Old, float New, bool Increase) {
@@ -1321,15 +1592,162 @@ inline void mqttPublishAll() {
   mqtt.Publish("CO2/ValueOut", GreenHouse.Sensors.mhz19out.CO2.Value());
   mqtt.Publish("CO2/ControlNotEffective", GreenHouse.Alerts.CO2.StateIs({_AlertState::LowNoEffect, _AlertState::HighNoEffect}));
   mqtt.Publish("CO2/AlertState", static_cast<int>(GreenHouse.Alerts.CO2.State()));
+
+  mqtt.Publish("Temperature/LatencyP95", GreenHouse.Latency.Temperature.SampleToRelay.Percentile(95) / 1000.0f);
+  mqtt.Publish("Humidity/LatencyP95", GreenHouse.Latency.Humidity.SampleToRelay.Percentile(95) / 1000.0f);
+  mqtt.Publish("CO2/LatencyP95", GreenHouse.Latency.CO2.SampleToRelay.Percentile(95) / 1000.0f);
+}
+
+inline void mqttPublishHistory() {
+  std::vector<std::pair<const char *, std::reference_wrapper<_Plot>>> r = {
+      {"Temperature/HistoryIn", Plots.TemperatureIn},
+      {"Humidity/HistoryIn", Plots.HumidityIn},
+      {"CO2/HistoryIn", Plots.CO2In},
+      {"Temperature/HistoryOut", Plots.TemperatureOut},
+      {"Humidity/HistoryOut", Plots.HumidityOut},
+      {"CO2/HistoryOut", Plots.CO2Out}};
+
+  for (auto &plot_ref : r) {
+    _Plot &plot = plot_ref.second.get();
+
+    size_t   capacity = sizeof(uint16_t) + _SeriesEncoder::maxBytes(plot.CurrentSize());
+    uint8_t *buffer   = new (std::nothrow) uint8_t[capacity];
+
+    if (!buffer)
+      continue;
+
+    mqtt.Publish(plot_ref.first, buffer, plot.Encode(buffer, capacity));
+
+    delete[] buffer;
+  }
+}
+
+// запись агрегата в X/AggregateIn|Out
+struct _AggregateRecord {
+  uint64_t From;
+  uint32_t Count;
+  float    Min;
+  float    Max;
+  float    Avg;
+  float    First;
+  float    Last;
+};
+
+// "History/aggregate" = "<минут в интервале>[,<часов назад>]": первый проход считает интервалы под длину, второй пишет
+inline void mqttPublishAggregate(const char *value) {
+  std::vector<std::pair<const char *, std::reference_wrapper<_Plot>>> r = {
+      {"Temperature/AggregateIn", Plots.TemperatureIn},
+      {"Humidity/AggregateIn", Plots.HumidityIn},
+      {"CO2/AggregateIn", Plots.CO2In},
+      {"Temperature/AggregateOut", Plots.TemperatureOut},
+      {"Humidity/AggregateOut", Plots.HumidityOut},
+      {"CO2/AggregateOut", Plots.CO2Out}};
+
+  uint minutes = 60;
+  uint hours   = 24;
+
+  sscanf(value, "%u,%u", &minutes, &hours);
+
+  if ((minutes < 1) || !sett.rtc.synced())
+    return;
+
+  const uint64_t interval = minutes * 60000ull;
+  const uint64_t to       = sett.rtc.getUnixMs();
+  const uint64_t from     = (hours > 0) ? to - min(to, hours * 3600000ull) : 0;
+
+  for (auto &plot_ref : r) {
+    _Plot &plot = plot_ref.second.get();
+
+    auto count = [](const _SeriesAggregate &) {};
+    auto write = [](const _SeriesAggregate &group) {
+      _AggregateRecord record = {group.From, group.Count, group.Min, group.Max, group.Avg(), group.First, group.Last};
+
+      mqtt.Write(reinterpret_cast<const uint8_t *>(&record), sizeof(record));
+    };
+
+    // долгая история - из раздела флеша, без него - то, что график держит в памяти.
+    // Длина сообщения считается отдельным проходом: оба - по одним границам и одному состоянию флеша
+    const uint16_t channel = Plots.Channel(plot);
+
+    if (flashlog.IsReady()) {
+      flashlog.Hold();
+
+      size_t groups = flashlog.aggregate(channel, from, to, interval, count);
+
+      if (mqtt.BeginPublish(plot_ref.first, groups * sizeof(_AggregateRecord))) {
+        flashlog.aggregate(channel, from, to, interval, write);
+        mqtt.EndPublish();
+      }
+
+      flashlog.Release();
+      continue;
+    }
+
+    if (!mqtt.BeginPublish(plot_ref.first, plot.Aggregate(from, to, interval, count) * sizeof(_AggregateRecord)))
+      continue;
+
+    plot.Aggregate(from, to, interval, write);
+
+    mqtt.EndPublish();
+  }
+}
+
+// "History/trends" = "h|d[,<интервалов назад>]": слоты _TrendRecord как есть, последний - открытый интервал
+inline void mqttPublishTrends(const char *value) {
+  char level = 'd';
+  uint count = 0;
+
+  sscanf(value, "%c,%u", &level, &count);
+
+  if (!sett.rtc.synced())
+    return;
+
+  const bool     hourly = (level == 'h');
+  const uint64_t length = hourly ? 3600000ull : 86400000ull;
+  const uint64_t now    = sett.rtc.getUnixMs();
+  const uint64_t from   = now - min(now, (count > 0 ? count : (hourly ? 24 : 7)) * length);
+  const auto     trend  = hourly ? _TrendLevel::Hour : _TrendLevel::Day;
+
+  // слоты за один проход в буфер: между двумя проходами задача persist может переписать файл
+  const size_t  capacity = (hourly ? TRENDS_HOURS : TRENDS_DAYS) + 1;
+  _TrendRecord *records  = new (std::nothrow) _TrendRecord[capacity];
+
+  if (!records)
+    return;
+
+  size_t groups = 0;
+
+  trends.forEach(trend, from, [records, capacity, &groups](const _TrendRecord &record) {
+    if (groups < capacity)
+      records[groups++] = record;
+  });
+
+  if (mqtt.BeginPublish(hourly ? "Trends/Hourly" : "Trends/Daily", groups * sizeof(_TrendRecord))) {
+    mqtt.Write(reinterpret_cast<const uint8_t *>(records), groups * sizeof(_TrendRecord));
+    mqtt.EndPublish();
+  }
+
+  delete[] records;
 }
 
 inline void mqttSubscribeAll() {
-  //
+  mqtt.Subscribe("History/get");
+  mqtt.Subscribe("History/aggregate");
+  mqtt.Subscribe("History/trends");
 }
 
 void mqttCallBack(const char *topic, const char *value, const uint length, const dbParams dbParam, const bool IsWrited) {
   if ((dbParam != dbParams::Undefined) && IsWrited)
     WebAction(dbParam, value);
+
+  if (strcmp(topic, "History/get") == 0)
+    mqttPublishHistory();
+
+  if (strcmp(topic, "History/aggregate") == 0)
+    mqttPublishAggregate(value);
+
+  if (strcmp(topic, "History/trends") == 0)
+    mqttPublishTrends(value);
 }
 
 inline void ReadingsBeforeSync(_Sync &Sync) {
@@ -1416,6 +1834,8 @@ void setup() {
   Serial.begin(115200);
   Serial.println();
 
+  boot.mark("setup");
+
   setStampZone(3);
 
   WiFi.setSleep(false);
@@ -1432,6 +1852,8 @@ void setup() {
 
   WiFiConnector.connect(WIFI_SSID, WIFI_PASS);
 
+  boot.mark("wifi");
+
   sett.begin();
   sett.onBuild(WebBuild);
   //  sett.onUpdate(WebUpdate);
@@ -1445,10 +1867,57 @@ void setup() {
   // sett.config.updateTout = 1000;
   // sett.config.theme = sets::Colors::Black;
 
-  _FS_Initialized = LittleFS.begin(true);
+  _FS_Initialized = LittleFS.begin(false);
+
+  // не смонтировался: первый запуск или новый partitions.csv. Форматируем, настройки - из копии в NVS
+  if (!_FS_Initialized) {
+    _FS_Initialized = LittleFS.begin(true);
+
+    if (_FS_Initialized)
+      settingsPersist.Restore();
+  }
+
+  if (_FS_Initialized)
+    persist.Begin();
+
+  // всё, что пишется на LittleFS, - через одно окно persist; свой таймер записи db выключен
+  db.setTimeout(UINT32_MAX);
+
+  persist.add(settingsPersist);
+  persist.add(HC);
+  persist.add(trends);
+
+  // буферы графиков - здесь, а не в конструкторах: PSRAM инициализирована только к setup()
+  Plots.begin();
+
+  for (_Plot *plot : {&Plots.TemperatureIn, &Plots.HumidityIn, &Plots.CO2In, &Plots.TemperatureOut, &Plots.HumidityOut, &Plots.CO2Out})
+    persist.add(*plot);
+
+  // разделы флеша пишет та же задача: в loop записи только копятся в RAM
+  persist.add(flashlog);
+  persist.add(blackbox.Persist());
+
+  boot.mark("fs");
+
+  if (flashlog.Begin())
+    Plots.OnArchive(PlotArchive);
+
+  boot.mark("flash log");
+
+  blackbox.Begin();
+
+  GreenHouse.Sensors.OnReadingsSample(ReadingsSample);
+
+  boot.mark("black box");
 
   db.begin();
 
+  // прошивка обновилась по OTA, а копии ещё нет - делаем сразу, до возможной смены partitions.csv
+  if (_FS_Initialized && !settingsPersist.HasBackup())
+    settingsPersist.Backup();
+
+  boot.mark("db");
+
   db.init(dbParams::SensorScanDelay, (uint)2);
 
   db.init(dbParams::TemperatureControlEnabled, (bool)0);
@@ -1508,6 +1977,25 @@ void setup() {
   db.init(dbParams::HumidityModeOut, (byte)1);
   db.init(dbParams::CO2ModeOut, (byte)1);
 
+  db.init(dbParams::TemperaturePlotInSize, (size_t)HIMIDITY_PLOT_SIZE);
+  db.init(dbParams::HumidityPlotInSize, (size_t)HIMIDITY_PLOT_SIZE);
+  db.init(dbParams::CO2PlotInSize, (size_t)HIMIDITY_PLOT_SIZE);
+
+  db.init(dbParams::TemperaturePlotOutSize, (size_t)HIMIDITY_PLOT_SIZE);
+  db.init(dbParams::HumidityPlotOutSize, (size_t)HIMIDITY_PLOT_SIZE);
+  db.init(dbParams::CO2PlotOutSize, (size_t)HIMIDITY_PLOT_SIZE);
+
+  db.init(dbParams::TemperaturePlotInEpsilon, 0.01f);
+  db.init(dbParams::HumidityPlotInEpsilon, HIMIDITY_PLOT_EPSILON);
+  db.init(dbParams::CO2PlotInEpsilon, 1.0f);
+
+  db.init(dbParams::TemperaturePlotOutEpsilon, 0.01f);
+  db.init(dbParams::HumidityPlotOutEpsilon, HIMIDITY_PLOT_EPSILON);
+  db.init(dbParams::CO2PlotOutEpsilon, 1.0f);
+
+  db.init(dbParams::PlotEpsilonAdaptive, (bool)0);
+  db.init(dbParams::PlotPointsPerHour, (uint)60);
+
   db.init(dbParams::MqttServer, (Text) "srv2.clusterfly.ru");
   db.init(dbParams::MqttPort, (uint)9991);
   db.init(dbParams::MqttUser, (Text) "user_b51554c5");
@@ -1520,6 +2008,7 @@ void setup() {
   debug.setModeInt(db[dbParams::DebugMode].toInt());
 
   GreenHouse.setSensorUpdateInterval(db[SensorScanDelay].toInt() * 1000ul);
+  blackbox.setSampleInterval(db[SensorScanDelay].toInt() * 1000ul);
 
   GreenHouse.Sensors.dht22in.setTemperatureStackSize(db[TemperatureInStackSize].toInt());
   GreenHouse.Sensors.dht22in.setHumidityStackSize(db[HumidityInStackSize].toInt());
@@ -1545,6 +2034,27 @@ void setup() {
   GreenHouse.Sensors.dht22out.Humidity.OnGetPrefix(GetHumidityOutPrefix);
   GreenHouse.Sensors.mhz19out.CO2.OnGetPrefix(GetCO2OutPrefix);
 
+  // с PSRAM лимиты и общий бюджет графиков больше в PSRAM_HISTORY_FACTOR раз
+  Plots.setBudget(PLOT_MEMORY_BUDGET * historyScale());
+
+  Plots.setLimit(Plots.TemperatureIn, db[TemperaturePlotInSize].toInt() * historyScale());
+  Plots.setLimit(Plots.HumidityIn, db[HumidityPlotInSize].toInt() * historyScale());
+  Plots.setLimit(Plots.CO2In, db[CO2PlotInSize].toInt() * historyScale());
+
+  Plots.setLimit(Plots.TemperatureOut, db[TemperaturePlotOutSize].toInt() * historyScale());
+  Plots.setLimit(Plots.HumidityOut, db[HumidityPlotOutSize].toInt() * historyScale());
+  Plots.setLimit(Plots.CO2Out, db[CO2PlotOutSize].toInt() * historyScale());
+
+  Plots.TemperatureIn.setEpsilon(db[TemperaturePlotInEpsilon].toFloat());
+  Plots.HumidityIn.setEpsilon(db[HumidityPlotInEpsilon].toFloat());
+  Plots.CO2In.setEpsilon(db[CO2PlotInEpsilon].toFloat());
+
+  Plots.TemperatureOut.setEpsilon(db[TemperaturePlotOutEpsilon].toFloat());
+  Plots.HumidityOut.setEpsilon(db[HumidityPlotOutEpsilon].toFloat());
+  Plots.CO2Out.setEpsilon(db[CO2PlotOutEpsilon].toFloat());
+
+  Plots.setTargetRate(db[PlotEpsilonAdaptive].toBool() ? db[PlotPointsPerHour].toInt() : 0);
+
   GreenHouse.Alerts.OnAlertStateChanged(AlertStateChanged);
   GreenHouse.Devices.OnDeviceActiveChanged(DeviceActiveChanged);
   GreenHouse.Devices.OnDeviceStateChanged(DeviceStateChanged);
@@ -1591,6 +2101,8 @@ void setup() {
   Params[dbParams::TemperatureModeOut] = db[TemperatureModeOut];
   Params[dbParams::HumidityModeOut]    = db[HumidityModeOut];
   Params[dbParams::CO2ModeOut]         = db[CO2ModeOut];
+
+  boot.mark("setup done");
 }
 
 void loop() {
@@ -1599,5 +2111,15 @@ void loop() {
   GreenHouse.Tick();
   HC.Tick();
 
-  p.Tick();
+  Plots.Tick();
+
+  trends.Tick();
+  persist.Tick();
+
+  // история догружается в фоне, регулирование к этому времени уже идёт
+  if (HC.IsLoaded())
+    boot.mark("controller");
+
+  if (Plots.IsLoaded())
+    boot.mark("plots");
 }
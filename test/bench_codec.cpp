@@ -0,0 +1,88 @@
+// Кодек рядов (src/_codec.h) на трассах: байт на точку и скорость кодирования/декодирования.
+//   bench_codec [blackbox.csv ...]   - трассы из tools/blackbox_decode.py, без аргументов - синтетические сутки
+
+#include "_codec.h"
+#include "_plotlog.h"
+#include "host.h"
+#include "traces.h"
+
+#include <chrono>
+
+#define BENCH_CODEC_ROUNDS 20
+
+static double seconds(std::chrono::steady_clock::duration Duration) {
+  return std::chrono::duration<double>(Duration).count();
+}
+
+static bool run(const _BenchTrace &Trace) {
+  const _SeriesBuffer &data  = Trace.Data;
+  const size_t         count = data.size();
+
+  if (count < 1)
+    return true;
+
+  std::vector<uint8_t> buffer(_SeriesEncoder::maxBytes(count));
+
+  size_t bytes = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t round = 0; round < BENCH_CODEC_ROUNDS; round++) {
+    _SeriesEncoder encoder(buffer.data(), buffer.size());
+
+    if (encoder.put(data, 0, count) != count)
+      return false;
+
+    bytes = encoder.bytes();
+  }
+
+  const double encode = seconds(std::chrono::steady_clock::now() - start) / BENCH_CODEC_ROUNDS;
+
+  size_t errors = 0;
+
+  start = std::chrono::steady_clock::now();
+
+  for (size_t round = 0; round < BENCH_CODEC_ROUNDS; round++) {
+    _SeriesDecoder decoder(buffer.data(), bytes);
+
+    for (size_t i = 0; i < count; i++) {
+      uint64_t time;
+      float    value;
+
+      if (!decoder.next(time, value) || (time != data.Time(i)) || (value != data.Value(i)))
+        errors++;
+    }
+  }
+
+  const double decode = seconds(std::chrono::steady_clock::now() - start) / BENCH_CODEC_ROUNDS;
+
+  printf("%-16s %6u pts, %7u -> %6u B, %5.2f B/pt (x%.1f), enc %6.1f Mpt/s, dec %6.1f Mpt/s, errors %u\n",
+         Trace.Name.c_str(),
+         (uint)count,
+         (uint)(count * sizeof(_PlotRecord)),
+         (uint)bytes,
+         (double)bytes / count,
+         (double)(count * sizeof(_PlotRecord)) / bytes,
+         count / encode / 1e6,
+         count / decode / 1e6,
+         (uint)errors);
+
+  return errors == 0;
+}
+
+int main(int argc, char **argv) {
+  _BenchTraces traces;
+
+  TraceLoad(argc, argv, traces);
+
+  int failures = 0;
+
+  for (const _BenchTrace *trace : traces) {
+    if (!run(*trace))
+      failures++;
+  }
+
+  TraceFree(traces);
+
+  return failures;
+}
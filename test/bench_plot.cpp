@@ -0,0 +1,53 @@
+// Компрессоры графиков (plotbench.h) на трассах: время, пиковая память, оставлено точек, ошибка восстановления.
+//   bench_plot [blackbox.csv ...]   - трассы из tools/blackbox_decode.py, без аргументов - синтетические сутки
+
+#include "host.h"
+#include "plotbench.h"
+#include "traces.h"
+
+// epsilon - разрешение датчика, размер - как у _Plot при бюджете PLOT_MEMORY_BUDGET на шесть каналов
+#define BENCH_PLOT_EPSILON 0.1f
+#define BENCH_PLOT_SIZE    512
+
+class _Stdout : public Print {
+public:
+  size_t write(uint8_t c) override {
+    return (fputc(c, stdout) != EOF) ? 1 : 0;
+  }
+
+  size_t write(const uint8_t *buffer, size_t size) override {
+    return fwrite(buffer, 1, size, stdout);
+  }
+};
+
+int main(int argc, char **argv) {
+  _BenchTraces traces;
+  _Stdout      out;
+
+  TraceLoad(argc, argv, traces);
+
+  for (size_t size : {(size_t)PLOT_BENCH_SIZE, (size_t)BENCH_PLOT_SIZE}) {
+    for (const _BenchTrace *trace : traces) {
+      _RawCompressor       raw(size);
+      _WindowRdpCompressor window(size, BENCH_PLOT_EPSILON);
+      _TableRdpCompressor  table(size, BENCH_PLOT_EPSILON);
+      _SwingDoorCompressor swing(size, BENCH_PLOT_EPSILON);
+
+      _PlotBench bench;
+
+      bench.add(raw);
+      bench.add(window);
+      bench.add(table);
+      bench.add(swing);
+
+      char name[64];
+      snprintf(name, sizeof(name), "%s, size %u, eps %.2f", trace->Name.c_str(), (uint)size, BENCH_PLOT_EPSILON);
+
+      bench.Run(name, trace->Data.Range(0, UINT64_MAX), out);
+    }
+  }
+
+  TraceFree(traces);
+
+  return 0;
+}
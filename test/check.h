@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdio>
+
+// Минимальные проверки хост-тестов: печать места ошибки, код возврата - число провалов
+static int _failures = 0;
+
+#define CHECK(Condition)                                                      \
+  do {                                                                        \
+    if (!(Condition)) {                                                       \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #Condition);    \
+      _failures++;                                                            \
+    }                                                                         \
+  } while (0)
+
+#define CHECK_LE(Value, Limit)                                                                               \
+  do {                                                                                                       \
+    if (!((Value) <= (Limit))) {                                                                             \
+      printf("%s:%d: %s = %g > %s = %g\n", __FILE__, __LINE__, #Value, (double)(Value), #Limit, (double)(Limit)); \
+      _failures++;                                                                                           \
+    }                                                                                                        \
+  } while (0)
+
+#define TEST_RESULT() (printf("%s\n", _failures ? "FAILED" : "OK"), _failures)
@@ -0,0 +1,279 @@
+#pragma once
+
+// Хост-подмена Arduino-ESP32 для тестов и бенчмарков: ровно то, что используют заголовки src/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <sys/types.h>
+#include <vector>
+
+// ulong и uint - из sys/types.h; ulong здесь 64-битный, разности millis() через long не переполняются
+typedef uint8_t byte;
+
+#define PROGMEM
+#define HIGH       1
+#define LOW        0
+#define OUTPUT     1
+#define DEC        10
+#define SERIAL_8N1 0
+
+using std::isnan;
+
+// millis() - управляемые часы теста (host::advance), micros() - настоящее время для замеров
+ulong millis();
+ulong micros();
+void  delay(unsigned long Ms);
+void  yield();
+void  pinMode(int, int);
+void  digitalWrite(int, int);
+int   digitalRead(int);
+long  random(long Max);
+bool  psramFound();
+void *ps_malloc(size_t Size);
+
+template <class A, class B>
+typename std::common_type<A, B>::type min(A a, B b) {
+  return a < b ? a : b;
+}
+
+template <class A, class B>
+typename std::common_type<A, B>::type max(A a, B b) {
+  return a > b ? a : b;
+}
+
+template <class A, class B, class C>
+A constrain(A a, B b, C c) {
+  return a < b ? b : (a > c ? c : a);
+}
+
+class String {
+private:
+  std::string _s;
+
+public:
+  String(const char *s = "") : _s(s ? s : "") {
+  }
+
+  String(const std::string &s) : _s(s) {
+  }
+
+  String(int v) : _s(std::to_string(v)) {
+  }
+
+  const char *c_str() const {
+    return _s.c_str();
+  }
+
+  size_t length() const {
+    return _s.size();
+  }
+
+  int indexOf(char c, int from = 0) const {
+    size_t i = _s.find(c, from);
+    return (i == std::string::npos) ? -1 : static_cast<int>(i);
+  }
+
+  String substring(int from, int to = -1) const {
+    return String(_s.substr(from, (to < 0) ? std::string::npos : to - from));
+  }
+
+  long toInt() const {
+    return atol(_s.c_str());
+  }
+
+  float toFloat() const {
+    return atof(_s.c_str());
+  }
+
+  bool operator==(const char *s) const {
+    return _s == s;
+  }
+
+  String &operator+=(const String &s) {
+    _s += s._s;
+    return *this;
+  }
+};
+
+class __FlashStringHelper;
+
+class Printable {};
+
+class Print {
+public:
+  virtual ~Print() {
+  }
+
+  virtual size_t write(uint8_t c) = 0;
+
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+
+    while (size--)
+      n += write(*buffer++);
+
+    return n;
+  }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    char    buffer[512];
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (len < 0)
+      return 0;
+
+    return write(reinterpret_cast<const uint8_t *>(buffer), min((size_t)len, sizeof(buffer) - 1));
+  }
+
+  size_t print(const char *s) {
+    return write(reinterpret_cast<const uint8_t *>(s), strlen(s));
+  }
+
+  size_t print(const String &s) {
+    return print(s.c_str());
+  }
+
+  size_t print(char c) {
+    return write(static_cast<uint8_t>(c));
+  }
+
+  size_t print(int v, int = DEC) {
+    return printf("%d", v);
+  }
+
+  size_t print(unsigned v, int = DEC) {
+    return printf("%u", v);
+  }
+
+  size_t print(long v, int = DEC) {
+    return printf("%ld", v);
+  }
+
+  size_t print(unsigned long v, int = DEC) {
+    return printf("%lu", v);
+  }
+
+  size_t print(double v, int digits = 2) {
+    return printf("%.*f", digits, v);
+  }
+
+  size_t print(const Printable &) {
+    return 0;
+  }
+
+  size_t println() {
+    return print("\n");
+  }
+
+  template <class T>
+  size_t println(T v) {
+    return print(v) + println();
+  }
+
+  template <class T>
+  size_t println(T v, int f) {
+    return print(v, f) + println();
+  }
+};
+
+class Stream : public Print {
+public:
+  size_t write(uint8_t) override {
+    return 1;
+  }
+
+  using Print::write;
+
+  virtual int available() {
+    return 0;
+  }
+
+  virtual int read() {
+    return -1;
+  }
+
+  size_t readBytes(uint8_t *buffer, size_t size) {
+    size_t n = 0;
+
+    for (int c; (n < size) && ((c = read()) >= 0); n++)
+      buffer[n] = static_cast<uint8_t>(c);
+
+    return n;
+  }
+
+  size_t readBytes(char *buffer, size_t size) {
+    return readBytes(reinterpret_cast<uint8_t *>(buffer), size);
+  }
+
+  String readStringUntil(char terminator) {
+    std::string s;
+
+    for (int c; ((c = read()) >= 0) && (c != terminator);)
+      s += static_cast<char>(c);
+
+    return String(s);
+  }
+
+  size_t readBytesUntil(char terminator, char *buffer, size_t size) {
+    size_t n = 0;
+
+    for (int c; (n < size) && ((c = read()) >= 0) && (c != terminator); n++)
+      buffer[n] = static_cast<char>(c);
+
+    return n;
+  }
+};
+
+// Serial - в stdout, если тест не заглушил вывод
+class HardwareSerial : public Stream {
+public:
+  bool Quiet = true;
+
+  HardwareSerial(int = 0) {
+  }
+
+  void begin(unsigned long, int = 0, int = 0, int = 0) {
+  }
+
+  size_t write(uint8_t c) override {
+    if (!Quiet)
+      fputc(c, stdout);
+
+    return 1;
+  }
+
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+struct EspClass {
+  size_t getHeapSize();
+  size_t getFreeHeap();
+  size_t getMinFreeHeap();
+  size_t getMaxAllocHeap();
+  size_t getPsramSize();
+  size_t getFreePsram();
+  void   restart();
+};
+
+extern EspClass ESP;
+
+#include "freertos/FreeRTOS.h"
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+enum SeekMode {
+  SeekSet = 0,
+  SeekCur = 1,
+  SeekEnd = 2
+};
+
+// Файл LittleFS поверх файла в host::setFsRoot()
+class File : public Stream {
+private:
+  std::shared_ptr<FILE> _f;
+  std::string           _name;
+
+public:
+  File() {
+  }
+
+  File(FILE *f, const std::string &name) : _f(f, fclose), _name(name) {
+  }
+
+  explicit operator bool() const {
+    return _f != nullptr;
+  }
+
+  size_t write(uint8_t c) override {
+    return _f ? fwrite(&c, 1, 1, _f.get()) : 0;
+  }
+
+  size_t write(const uint8_t *buffer, size_t size) override {
+    return _f ? fwrite(buffer, 1, size, _f.get()) : 0;
+  }
+
+  size_t read(uint8_t *buffer, size_t size) {
+    return _f ? fread(buffer, 1, size, _f.get()) : 0;
+  }
+
+  int read() override {
+    return _f ? fgetc(_f.get()) : -1;
+  }
+
+  int available() override {
+    return _f ? static_cast<int>(size() - position()) : 0;
+  }
+
+  size_t size() const {
+    if (!_f)
+      return 0;
+
+    long pos = ftell(_f.get());
+    fseek(_f.get(), 0, SEEK_END);
+    long end = ftell(_f.get());
+    fseek(_f.get(), pos, SEEK_SET);
+
+    return static_cast<size_t>(end);
+  }
+
+  size_t position() const {
+    return _f ? static_cast<size_t>(ftell(_f.get())) : 0;
+  }
+
+  bool seek(uint32_t pos, SeekMode mode = SeekSet) {
+    return _f && (fseek(_f.get(), pos, (mode == SeekSet) ? SEEK_SET : (mode == SeekCur) ? SEEK_CUR : SEEK_END) == 0);
+  }
+
+  void flush() {
+    if (_f)
+      fflush(_f.get());
+  }
+
+  void close() {
+    _f.reset();
+  }
+
+  bool isDirectory() {
+    return false;
+  }
+
+  File openNextFile() {
+    return File();
+  }
+
+  const char *name() const {
+    return _name.c_str();
+  }
+};
+
+class FS {
+protected:
+  std::string _Path(const char *path) const;
+
+public:
+  File open(const char *path, const char *mode = FILE_READ, bool create = false);
+
+  File open(const String &path, const char *mode = FILE_READ, bool create = false) {
+    return open(path.c_str(), mode, create);
+  }
+
+  bool exists(const char *path);
+  bool remove(const char *path);
+  bool rename(const char *from, const char *to);
+
+  bool mkdir(const char *) {
+    return true;
+  }
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+namespace gdb {
+  enum class Type {
+    None,
+    Int,
+    Uint,
+    Float,
+    String
+  };
+}
+
+class Text {
+private:
+  String _s;
+
+public:
+  Text(const char *s = "") : _s(s) {
+  }
+
+  Text(const String &s) : _s(s) {
+  }
+
+  int32_t toInt() const {
+    return _s.toInt();
+  }
+
+  float toFloat() const {
+    return _s.toFloat();
+  }
+
+  bool toBool() const {
+    return _s.toInt() != 0;
+  }
+
+  String toString() const {
+    return _s;
+  }
+};
+
+struct DBEntry {
+  int32_t toInt() const {
+    return 0;
+  }
+
+  float toFloat() const {
+    return 0;
+  }
+
+  bool toBool() const {
+    return false;
+  }
+
+  String toString() const {
+    return String();
+  }
+
+  gdb::Type type() const {
+    return gdb::Type::Int;
+  }
+
+  template <class T>
+  DBEntry &operator=(T) {
+    return *this;
+  }
+
+  operator bool() const {
+    return false;
+  }
+};
+
+// настройки в тестах не участвуют: только интерфейс
+class GyverDBFile {
+public:
+  GyverDBFile(FS *, const char *, uint32_t = 10000) {
+  }
+
+  bool begin() {
+    return true;
+  }
+
+  template <class T>
+  bool init(size_t, T) {
+    return true;
+  }
+
+  DBEntry operator[](size_t) {
+    return DBEntry();
+  }
+
+  bool update() {
+    return true;
+  }
+
+  bool tick() {
+    return true;
+  }
+
+  void setTimeout(uint32_t = 10000) {
+  }
+
+  bool changed() {
+    return false;
+  }
+};
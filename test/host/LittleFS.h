@@ -0,0 +1,27 @@
+#pragma once
+
+#include "FS.h"
+
+class LittleFSFS : public FS {
+public:
+  bool begin(bool = false, const char * = "/littlefs", uint8_t = 10, const char * = "spiffs") {
+    return true;
+  }
+
+  bool format() {
+    return true;
+  }
+
+  void end() {
+  }
+
+  size_t totalBytes() {
+    return 0xA0000;
+  }
+
+  size_t usedBytes() {
+    return 0;
+  }
+};
+
+extern LittleFSFS LittleFS;
@@ -0,0 +1,22 @@
+#pragma once
+
+// NVS в памяти процесса: пространства имён и ключи как у Arduino-ESP32 Preferences
+
+#include <Arduino.h>
+
+class Preferences {
+private:
+  std::string _namespace;
+  bool        _readOnly = false;
+  bool        _open     = false;
+
+public:
+  bool begin(const char *Name, bool ReadOnly = false);
+  void end();
+
+  size_t putBytes(const char *Key, const void *Value, size_t Length);
+  size_t getBytesLength(const char *Key);
+  size_t getBytes(const char *Key, void *Buffer, size_t MaxLength);
+
+  bool remove(const char *Key);
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+#include <GyverDBFile.h>
+#include <Table.h>
+
+#define H(x) ((size_t)0)
+
+void setStampZone(int);
+
+namespace sets {
+
+  class Logger : public Print {
+  public:
+    Logger(size_t) {
+    }
+
+    size_t write(uint8_t) override {
+      return 1;
+    }
+
+    using Print::write;
+
+    void clear() {
+    }
+  };
+
+  // часы управляются из теста: host::setUnixMs() / host::unsync()
+  struct RTC {
+    bool     synced();
+    uint64_t getUnixMs();
+    uint32_t getUnix();
+  };
+
+} // namespace sets
+
+class SettingsGyverWS {
+public:
+  sets::RTC rtc;
+
+  SettingsGyverWS(const char *, GyverDBFile *) {
+  }
+
+  void begin() {
+  }
+
+  void tick() {
+  }
+
+  void reload() {
+  }
+};
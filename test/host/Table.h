@@ -0,0 +1,201 @@
+#pragma once
+
+// Хост-подмена GyverLibs/Table: строки ячеек с типом по столбцу, без бинарного формата файла
+
+#include <Arduino.h>
+#include <type_traits>
+
+enum class cell_t {
+  Int8,
+  Uint8,
+  Int16,
+  Uint16,
+  Int32,
+  Uint32,
+  Int64,
+  Uint64,
+  Float,
+  None
+};
+
+namespace tbl {
+
+  struct Cell {
+    cell_t   Type = cell_t::None;
+    uint64_t Bits = 0;
+    float    F    = 0;
+
+    int64_t toInt64() const {
+      return (Type == cell_t::Float) ? static_cast<int64_t>(F) : static_cast<int64_t>(Bits);
+    }
+
+    int32_t toInt() const {
+      return static_cast<int32_t>(toInt64());
+    }
+
+    float toFloat() const {
+      return (Type == cell_t::Float) ? F : static_cast<float>(static_cast<int64_t>(Bits));
+    }
+
+    template <class T>
+    operator T() const {
+      return std::is_floating_point<T>::value ? static_cast<T>(toFloat()) : static_cast<T>(toInt64());
+    }
+
+    template <class T>
+    void set(T v) {
+      if (Type == cell_t::Float)
+        F = static_cast<float>(v);
+      else
+        Bits = static_cast<uint64_t>(v);
+    }
+
+    template <class T>
+    Cell &operator=(T v) {
+      set(v);
+      return *this;
+    }
+  };
+
+  struct Row {
+    std::vector<Cell> *Cells = nullptr;
+
+    Cell &operator[](int col) {
+      return (*Cells)[col];
+    }
+  };
+
+} // namespace tbl
+
+class Table {
+private:
+  std::vector<cell_t>              _types;
+  std::vector<std::vector<tbl::Cell>> _rows;
+  bool                             _changed = false;
+
+  void _Types() {
+  }
+
+  template <class... A>
+  void _Types(cell_t type, A... rest) {
+    _types.push_back(type);
+    _Types(rest...);
+  }
+
+  void _Put(std::vector<tbl::Cell> &, size_t) {
+  }
+
+  template <class T, class... A>
+  void _Put(std::vector<tbl::Cell> &row, size_t col, T v, A... rest) {
+    if (col < row.size())
+      row[col].set(v);
+
+    _Put(row, col + 1, rest...);
+  }
+
+public:
+  Table() {
+  }
+
+  template <class... A>
+  Table(uint16_t rows, uint8_t, A... types) {
+    _Types(types...);
+    reserve(rows);
+  }
+
+  template <class... A>
+  void init(uint8_t, A... types) {
+    _types.clear();
+    _rows.clear();
+    _Types(types...);
+  }
+
+  template <class... A>
+  bool append(A... values) {
+    std::vector<tbl::Cell> row(_types.size());
+
+    for (size_t i = 0; i < _types.size(); i++)
+      row[i].Type = _types[i];
+
+    _Put(row, 0, values...);
+    _rows.push_back(row);
+
+    _changed = true;
+
+    return true;
+  }
+
+  template <class... A>
+  bool add(A... values) {
+    return append(values...);
+  }
+
+  tbl::Row operator[](int row) {
+    return tbl::Row{&_rows[row]};
+  }
+
+  tbl::Row get(int row) {
+    return (*this)[row];
+  }
+
+  size_t rows() const {
+    return _rows.size();
+  }
+
+  size_t cols() const {
+    return _types.size();
+  }
+
+  bool remove(int row) {
+    if ((row < 0) || (static_cast<size_t>(row) >= _rows.size()))
+      return false;
+
+    _rows.erase(_rows.begin() + row);
+    _changed = true;
+
+    return true;
+  }
+
+  void removeAll() {
+    _rows.clear();
+    _changed = true;
+  }
+
+  bool reserve(uint16_t rows) {
+    _rows.reserve(rows);
+    return true;
+  }
+
+  bool resize(uint16_t rows) {
+    std::vector<tbl::Cell> row(_types.size());
+
+    for (size_t i = 0; i < _types.size(); i++)
+      row[i].Type = _types[i];
+
+    _rows.resize(rows, row);
+
+    return true;
+  }
+
+  bool changed() {
+    return _changed;
+  }
+
+  void clearChanged() {
+    _changed = false;
+  }
+
+  bool writeTo(Stream &) {
+    return false;
+  }
+
+  bool readFrom(Stream &, size_t) {
+    return false;
+  }
+
+  template <class T>
+  bool set(int row, int col, T v) {
+    _rows[row][col].set(v);
+    return true;
+  }
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define WL_CONNECTED 3
+
+struct WiFiClass {
+  bool isConnected() {
+    return false;
+  }
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient {};
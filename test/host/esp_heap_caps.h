@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+
+// malloc/free; число выделений с MALLOC_CAP_SPIRAM - host::psramAllocs()
+void  *heap_caps_malloc(size_t Size, uint32_t Caps);
+void  *heap_caps_realloc(void *Ptr, size_t Size, uint32_t Caps);
+void   heap_caps_free(void *Ptr);
+size_t heap_caps_get_free_size(uint32_t Caps);
+size_t heap_caps_get_largest_free_block(uint32_t Caps);
@@ -0,0 +1,51 @@
+#pragma once
+
+// Разделы флеша на файлах (host::addPartition): запись только сбрасывает биты, как NOR-флеш, стирание - в 0xFF
+
+#include <cstddef>
+#include <cstdint>
+
+typedef int esp_err_t;
+
+#define ESP_OK               0
+#define ESP_FAIL             -1
+#define ESP_ERR_INVALID_ARG  0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum {
+  ESP_PARTITION_TYPE_APP  = 0x00,
+  ESP_PARTITION_TYPE_DATA = 0x01
+} esp_partition_type_t;
+
+typedef enum {
+  ESP_PARTITION_SUBTYPE_ANY = 0xff
+} esp_partition_subtype_t;
+
+// IDF 4.4 (Arduino-ESP32 2.x): отображение через spi_flash_*
+typedef enum {
+  SPI_FLASH_MMAP_DATA,
+  SPI_FLASH_MMAP_INST
+} spi_flash_mmap_memory_t;
+
+typedef uint32_t spi_flash_mmap_handle_t;
+
+typedef struct {
+  esp_partition_type_t    type;
+  esp_partition_subtype_t subtype;
+  uint32_t                address;
+  uint32_t                size;
+  uint32_t                erase_size;
+  char                    label[17];
+  bool                    encrypted;
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t Type, esp_partition_subtype_t SubType, const char *Label);
+
+esp_err_t esp_partition_read(const esp_partition_t *Partition, size_t Offset, void *Dst, size_t Size);
+esp_err_t esp_partition_write(const esp_partition_t *Partition, size_t Offset, const void *Src, size_t Size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *Partition, size_t Offset, size_t Size);
+
+esp_err_t esp_partition_mmap(const esp_partition_t *Partition, size_t Offset, size_t Size, spi_flash_mmap_memory_t Memory, const void **Ptr, spi_flash_mmap_handle_t *Handle);
+void      spi_flash_munmap(spi_flash_mmap_handle_t Handle);
@@ -0,0 +1,36 @@
+#pragma once
+
+// Хост: задач нет - xTaskCreatePinnedToCore() не создаёт задачу, и _PersistWorker пишет прямо из вызова
+
+#include <cstdint>
+
+typedef void    *TaskHandle_t;
+typedef void    *QueueHandle_t;
+typedef void    *SemaphoreHandle_t;
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE           1
+#define pdFALSE          0
+#define pdPASS           1
+#define pdFAIL           0
+#define portMAX_DELAY    0xffffffff
+#define pdMS_TO_TICKS(x) (x)
+#define tskIDLE_PRIORITY 0
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t, TaskHandle_t *, BaseType_t);
+BaseType_t xTaskCreate(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t, TaskHandle_t *);
+void       vTaskDelay(TickType_t);
+void       vTaskDelete(TaskHandle_t);
+
+QueueHandle_t xQueueCreate(UBaseType_t Length, UBaseType_t ItemSize);
+BaseType_t    xQueueSend(QueueHandle_t Queue, const void *Item, TickType_t Wait);
+BaseType_t    xQueueReceive(QueueHandle_t Queue, void *Item, TickType_t Wait);
+UBaseType_t   uxQueueMessagesWaiting(QueueHandle_t Queue);
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t        xSemaphoreTake(SemaphoreHandle_t, TickType_t);
+BaseType_t        xSemaphoreGive(SemaphoreHandle_t);
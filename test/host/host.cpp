@@ -0,0 +1,516 @@
+// Реализация хост-подмен: часы, RTC, LittleFS в каталоге, разделы флеша на файлах, CRC как в ROM ESP32
+
+#include "host.h"
+
+#include <FS.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <SettingsGyverWS.h>
+#include <WiFi.h>
+#include <chrono>
+#include <esp_heap_caps.h>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <rom/crc.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+
+HardwareSerial Serial;
+EspClass       ESP;
+LittleFSFS     LittleFS;
+WiFiClass      WiFi;
+
+namespace {
+
+  ulong    _millis  = 0;
+  bool     _psram   = false;
+  bool     _synced  = false;
+  uint64_t _unixMs  = 0;
+  ulong    _unixAt  = 0;
+  size_t   _erases  = 0;
+  size_t   _writes  = 0;
+  std::string _root = ".";
+
+  struct _Partition {
+    esp_partition_t      Info;
+    std::string          Path;
+    std::vector<uint8_t> Data;
+    FILE                *File = nullptr;
+
+    ~_Partition() {
+      if (File)
+        fclose(File);
+    }
+
+    // на файл - только изменённый участок
+    void save(size_t Offset, size_t Size) {
+      if (!File)
+        return;
+
+      fseek(File, Offset, SEEK_SET);
+      fwrite(Data.data() + Offset, 1, Size, File);
+      fflush(File);
+    }
+  };
+
+  std::vector<std::unique_ptr<_Partition>> _partitions;
+
+  // NVS: пространство имён -> ключ -> значение, живёт до host::clearNvs()
+  std::map<std::string, std::map<std::string, std::vector<uint8_t>>> _nvs;
+
+  _Partition *_Find(const esp_partition_t *Partition) {
+    for (auto &p : _partitions) {
+      if (&p->Info == Partition)
+        return p.get();
+    }
+
+    return nullptr;
+  }
+
+} // namespace
+
+namespace host {
+
+  void setMillis(ulong Ms) {
+    _millis = Ms;
+  }
+
+  void advance(ulong Ms) {
+    _millis += Ms;
+  }
+
+  void setPsram(bool Found) {
+    _psram = Found;
+  }
+
+  void setUnixMs(uint64_t UnixMs) {
+    _synced = true;
+    _unixMs = UnixMs;
+    _unixAt = _millis;
+  }
+
+  void unsync() {
+    _synced = false;
+  }
+
+  bool addPartition(const char *Label, uint8_t SubType, size_t Size, const char *Path) {
+    std::unique_ptr<_Partition> p(new _Partition());
+
+    p->Info.type       = ESP_PARTITION_TYPE_DATA;
+    p->Info.subtype    = static_cast<esp_partition_subtype_t>(SubType);
+    p->Info.address    = 0;
+    p->Info.size       = Size;
+    p->Info.erase_size = SPI_FLASH_SEC_SIZE;
+    p->Info.encrypted  = false;
+    p->Path            = Path;
+
+    snprintf(p->Info.label, sizeof(p->Info.label), "%s", Label);
+
+    p->Data.assign(Size, 0xFF);
+
+    p->File = fopen(Path, "r+b");
+
+    if (p->File) {
+      size_t n = fread(p->Data.data(), 1, Size, p->File);
+
+      (void)n;
+    } else {
+      p->File = fopen(Path, "w+b");
+
+      p->save(0, Size);
+    }
+
+    _partitions.push_back(std::move(p));
+
+    return true;
+  }
+
+  void removePartitions() {
+    _partitions.clear();
+  }
+
+  size_t partitionErases() {
+    return _erases;
+  }
+
+  size_t partitionWrites() {
+    return _writes;
+  }
+
+  void clearNvs() {
+    _nvs.clear();
+  }
+
+  void setFsRoot(const char *Path) {
+    _root = Path;
+  }
+
+} // namespace host
+
+ulong millis() {
+  return _millis;
+}
+
+ulong micros() {
+  using namespace std::chrono;
+
+  return static_cast<ulong>(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+void delay(unsigned long Ms) {
+  _millis += Ms;
+}
+
+void yield() {
+}
+
+void pinMode(int, int) {
+}
+
+void digitalWrite(int, int) {
+}
+
+int digitalRead(int) {
+  return 0;
+}
+
+long random(long Max) {
+  return (Max > 0) ? rand() % Max : 0;
+}
+
+bool psramFound() {
+  return _psram;
+}
+
+void *ps_malloc(size_t Size) {
+  return malloc(Size);
+}
+
+size_t EspClass::getHeapSize() {
+  return 320 * 1024;
+}
+
+size_t EspClass::getFreeHeap() {
+  return 160 * 1024;
+}
+
+size_t EspClass::getMinFreeHeap() {
+  return 120 * 1024;
+}
+
+size_t EspClass::getMaxAllocHeap() {
+  return 100 * 1024;
+}
+
+size_t EspClass::getPsramSize() {
+  return _psram ? 4 * 1024 * 1024 : 0;
+}
+
+size_t EspClass::getFreePsram() {
+  return getPsramSize();
+}
+
+void EspClass::restart() {
+}
+
+void setStampZone(int) {
+}
+
+bool sets::RTC::synced() {
+  return _synced;
+}
+
+uint64_t sets::RTC::getUnixMs() {
+  return _synced ? _unixMs + (_millis - _unixAt) : 0;
+}
+
+uint32_t sets::RTC::getUnix() {
+  return static_cast<uint32_t>(getUnixMs() / 1000);
+}
+
+void *heap_caps_malloc(size_t Size, uint32_t) {
+  return malloc(Size);
+}
+
+void *heap_caps_realloc(void *Ptr, size_t Size, uint32_t) {
+  return realloc(Ptr, Size);
+}
+
+void heap_caps_free(void *Ptr) {
+  free(Ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t) {
+  return 160 * 1024;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t) {
+  return 100 * 1024;
+}
+
+// LittleFS
+
+std::string FS::_Path(const char *path) const {
+  return _root + ((path[0] == '/') ? "" : "/") + path;
+}
+
+File FS::open(const char *path, const char *mode, bool) {
+  const char *_mode = (strcmp(mode, FILE_WRITE) == 0)    ? "w+b"
+                      : (strcmp(mode, FILE_APPEND) == 0) ? "a+b"
+                      : (strcmp(mode, "r+") == 0)        ? "r+b"
+                                                         : "rb";
+
+  FILE *f = fopen(_Path(path).c_str(), _mode);
+
+  return f ? File(f, path) : File();
+}
+
+bool FS::exists(const char *path) {
+  FILE *f = fopen(_Path(path).c_str(), "rb");
+
+  if (f)
+    fclose(f);
+
+  return f != nullptr;
+}
+
+bool FS::remove(const char *path) {
+  return ::remove(_Path(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to) {
+  return ::rename(_Path(from).c_str(), _Path(to).c_str()) == 0;
+}
+
+// Разделы
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t Type, esp_partition_subtype_t SubType, const char *Label) {
+  for (auto &p : _partitions) {
+    if ((p->Info.type == Type) &&
+        ((SubType == ESP_PARTITION_SUBTYPE_ANY) || (p->Info.subtype == SubType)) &&
+        (!Label || (strcmp(p->Info.label, Label) == 0)))
+      return &p->Info;
+  }
+
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *Partition, size_t Offset, void *Dst, size_t Size) {
+  _Partition *p = _Find(Partition);
+
+  if (!p)
+    return ESP_ERR_INVALID_ARG;
+
+  if (Offset + Size > p->Data.size())
+    return ESP_ERR_INVALID_SIZE;
+
+  memcpy(Dst, p->Data.data() + Offset, Size);
+
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *Partition, size_t Offset, const void *Src, size_t Size) {
+  _Partition *p = _Find(Partition);
+
+  if (!p)
+    return ESP_ERR_INVALID_ARG;
+
+  if (Offset + Size > p->Data.size())
+    return ESP_ERR_INVALID_SIZE;
+
+  const uint8_t *src = static_cast<const uint8_t *>(Src);
+
+  for (size_t i = 0; i < Size; i++)
+    p->Data[Offset + i] &= src[i];
+
+  _writes++;
+
+  p->save(Offset, Size);
+
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *Partition, size_t Offset, size_t Size) {
+  _Partition *p = _Find(Partition);
+
+  if (!p)
+    return ESP_ERR_INVALID_ARG;
+
+  if ((Offset % SPI_FLASH_SEC_SIZE) || (Size % SPI_FLASH_SEC_SIZE) || (Offset + Size > p->Data.size()))
+    return ESP_ERR_INVALID_SIZE;
+
+  memset(p->Data.data() + Offset, 0xFF, Size);
+
+  _erases++;
+
+  p->save(Offset, Size);
+
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *Partition, size_t Offset, size_t Size, spi_flash_mmap_memory_t, const void **Ptr, spi_flash_mmap_handle_t *Handle) {
+  _Partition *p = _Find(Partition);
+
+  if (!p)
+    return ESP_ERR_INVALID_ARG;
+
+  if (Offset + Size > p->Data.size())
+    return ESP_ERR_INVALID_SIZE;
+
+  *Ptr    = p->Data.data() + Offset;
+  *Handle = 1;
+
+  return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t) {
+}
+
+// CRC, отражённые полиномы
+
+uint32_t crc32_le(uint32_t Crc, const uint8_t *Buffer, uint32_t Length) {
+  Crc = ~Crc;
+
+  while (Length--) {
+    Crc ^= *Buffer++;
+
+    for (int i = 0; i < 8; i++)
+      Crc = (Crc & 1) ? (Crc >> 1) ^ 0xEDB88320u : Crc >> 1;
+  }
+
+  return ~Crc;
+}
+
+uint16_t crc16_le(uint16_t Crc, const uint8_t *Buffer, uint32_t Length) {
+  Crc = ~Crc;
+
+  while (Length--) {
+    Crc ^= *Buffer++;
+
+    for (int i = 0; i < 8; i++)
+      Crc = (Crc & 1) ? (Crc >> 1) ^ 0x8408 : Crc >> 1;
+  }
+
+  return ~Crc;
+}
+
+// FreeRTOS: задача не создаётся, очередь - обычная
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t, TaskHandle_t *, BaseType_t) {
+  return pdFAIL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t, TaskHandle_t *) {
+  return pdFAIL;
+}
+
+void vTaskDelay(TickType_t Ticks) {
+  _millis += Ticks;
+}
+
+void vTaskDelete(TaskHandle_t) {
+}
+
+namespace {
+
+  struct _Queue {
+    size_t                            ItemSize;
+    size_t                            Length;
+    std::deque<std::vector<uint8_t>> Items;
+  };
+
+} // namespace
+
+QueueHandle_t xQueueCreate(UBaseType_t Length, UBaseType_t ItemSize) {
+  return new _Queue{ItemSize, Length, {}};
+}
+
+BaseType_t xQueueSend(QueueHandle_t Queue, const void *Item, TickType_t) {
+  _Queue *q = static_cast<_Queue *>(Queue);
+
+  if (q->Items.size() >= q->Length)
+    return pdFALSE;
+
+  const uint8_t *src = static_cast<const uint8_t *>(Item);
+
+  q->Items.emplace_back(src, src + q->ItemSize);
+
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t Queue, void *Item, TickType_t) {
+  _Queue *q = static_cast<_Queue *>(Queue);
+
+  if (q->Items.empty())
+    return pdFALSE;
+
+  memcpy(Item, q->Items.front().data(), q->ItemSize);
+  q->Items.pop_front();
+
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t Queue) {
+  return static_cast<_Queue *>(Queue)->Items.size();
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return reinterpret_cast<SemaphoreHandle_t>(1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) {
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t) {
+  return pdTRUE;
+}
+
+// Preferences
+
+bool Preferences::begin(const char *Name, bool ReadOnly) {
+  _namespace = Name;
+  _readOnly  = ReadOnly;
+  _open      = true;
+
+  return true;
+}
+
+void Preferences::end() {
+  _open = false;
+}
+
+size_t Preferences::putBytes(const char *Key, const void *Value, size_t Length) {
+  if (!_open || _readOnly)
+    return 0;
+
+  const uint8_t *value = static_cast<const uint8_t *>(Value);
+
+  _nvs[_namespace][Key].assign(value, value + Length);
+
+  return Length;
+}
+
+size_t Preferences::getBytesLength(const char *Key) {
+  if (!_open || !_nvs[_namespace].count(Key))
+    return 0;
+
+  return _nvs[_namespace][Key].size();
+}
+
+size_t Preferences::getBytes(const char *Key, void *Buffer, size_t MaxLength) {
+  const size_t length = getBytesLength(Key);
+
+  if ((length < 1) || (length > MaxLength))
+    return 0;
+
+  memcpy(Buffer, _nvs[_namespace][Key].data(), length);
+
+  return length;
+}
+
+bool Preferences::remove(const char *Key) {
+  return _open && !_readOnly && _nvs[_namespace].erase(Key);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Управление подменами из тестов
+namespace host {
+
+  void setMillis(ulong Ms);
+  void advance(ulong Ms);
+
+  void setPsram(bool Found);
+
+  // RTC: synced() и getUnixMs() = UnixMs + (millis() - момент setUnixMs)
+  void setUnixMs(uint64_t UnixMs);
+  void unsync();
+
+  // раздел data с меткой Label на файле Path: содержимое переживает "перезагрузку" (новый процесс или reopen)
+  bool addPartition(const char *Label, uint8_t SubType, size_t Size, const char *Path);
+  void removePartitions();
+
+  // число erase_range / write по всем разделам - оценка работы на флеше
+  size_t partitionErases();
+  size_t partitionWrites();
+
+  // стирает Preferences (NVS)
+  void clearNvs();
+
+  // каталог, в котором живёт LittleFS
+  void setFsRoot(const char *Path);
+
+} // namespace host
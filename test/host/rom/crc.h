@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// как в ROM ESP32: инверсия на входе и выходе, отражённые полиномы; crc32_le(0, ...) = zlib crc32
+uint32_t crc32_le(uint32_t Crc, const uint8_t *Buffer, uint32_t Length);
+uint16_t crc16_le(uint16_t Crc, const uint8_t *Buffer, uint32_t Length);
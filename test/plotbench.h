@@ -0,0 +1,393 @@
+#pragma once
+
+#include "_common.h"
+#include "_rdp.h"
+#include "_series.h"
+#include <Table.h>
+#include <vector>
+
+#define PLOT_BENCH_RDP_STACK_SIZE 128
+#define PLOT_BENCH_SIZE           64 // меньше трассы, чтобы сработали и пересжатие, и вытеснение
+
+// Компрессор для сравнения: получает записанную трассу целиком, отдаёт оставленные точки
+class _PlotCompressor {
+public:
+  virtual ~_PlotCompressor() {
+  }
+
+  virtual const char *Name() const = 0;
+
+  // false - не хватило памяти
+  virtual bool Run(const _SeriesView &Trace, _SeriesBuffer &Out) = 0;
+
+  // рабочая память на пике последнего прогона, байт
+  virtual size_t PeakBytes() const = 0;
+};
+
+// без сжатия: кольцо последних MaxSize точек - точка отсчёта для остальных
+class _RawCompressor : public _PlotCompressor {
+private:
+  size_t _maxSize = 0;
+  size_t _peak    = 0;
+
+public:
+  _RawCompressor(size_t MaxSize) : _maxSize(MaxSize) {
+  }
+
+  const char *Name() const override {
+    return "raw";
+  }
+
+  bool Run(const _SeriesView &Trace, _SeriesBuffer &Out) override {
+    _SeriesBuffer _ring;
+
+    if (!_ring.setCapacity(_maxSize))
+      return false;
+
+    for (size_t i = 0; i < Trace.size(); i++)
+      _ring.append(Trace.Time(i), Trace.Value(i));
+
+    _peak = _ring.bytes();
+
+    return Out.assign(_ring);
+  }
+
+  size_t PeakBytes() const override {
+    return _peak;
+  }
+};
+
+// текущий _Plot: swing door на входе, RDP с ростом epsilon при заполнении
+class _SwingDoorCompressor : public _PlotCompressor {
+private:
+  size_t _maxSize = 0;
+  float  _epsilon = 0;
+  size_t _peak    = 0;
+
+public:
+  _SwingDoorCompressor(size_t MaxSize, float Epsilon) : _maxSize(MaxSize), _epsilon(Epsilon) {
+  }
+
+  const char *Name() const override {
+    return "swing door";
+  }
+
+  bool Run(const _SeriesView &Trace, _SeriesBuffer &Out) override {
+    _Plot *_plot = new (std::nothrow) _Plot(_SubType::Undefined, _maxSize, _epsilon);
+
+    if (!_plot || !_plot->begin()) {
+      delete _plot;
+      return false;
+    }
+
+    for (size_t i = 0; i < Trace.size(); i++)
+      _plot->putValue(Trace.Time(i), Trace.Value(i));
+
+    _peak = _plot->Bytes();
+
+    bool _ok = Out.assign(_plot->Series());
+
+    delete _plot;
+
+    return _ok;
+  }
+
+  size_t PeakBytes() const override {
+    return _peak;
+  }
+};
+
+// прежние компрессоры на Table: RDP со стеком не больше PLOT_BENCH_RDP_STACK_SIZE отрезков
+class _TableCompressor : public _PlotCompressor {
+protected:
+  size_t _maxSize = 0;
+  float  _epsilon = 0;
+  size_t _peak    = 0;
+
+  static const size_t ROW_BYTES = sizeof(uint64_t) + sizeof(float);
+
+  static float _Distance(uint64_t Time1, float Value1, uint64_t Time2, float Value2, uint64_t TimeP, float ValueP) {
+    const float _dx = static_cast<float>(Time2 - Time1);
+
+    if (_dx == 0)
+      return fabs(ValueP - Value1);
+
+    const float _slope     = (Value2 - Value1) / _dx;
+    const float _intercept = Value1 - _slope * Time1;
+
+    return fabs(_slope * TimeP - ValueP + _intercept) / sqrt(_slope * _slope + 1.0f);
+  }
+
+  // отмечает в Keep точки, которые оставляет RDP (концы - на вызывающем); возвращает байты стека
+  size_t _Mark(Table &Data, std::vector<bool> &Keep) {
+    std::vector<std::pair<size_t, size_t>> _stack;
+    _stack.reserve(PLOT_BENCH_RDP_STACK_SIZE);
+    _stack.emplace_back(0, Data.rows() - 1);
+
+    while (!_stack.empty() && (_stack.size() < PLOT_BENCH_RDP_STACK_SIZE)) {
+      auto _segment = _stack.back();
+      _stack.pop_back();
+
+      if (_segment.second <= _segment.first + 1)
+        continue;
+
+      uint64_t _timeStart  = Data[_segment.first][0];
+      float    _valueStart = Data[_segment.first][1];
+      uint64_t _timeEnd    = Data[_segment.second][0];
+      float    _valueEnd   = Data[_segment.second][1];
+
+      float  _maxDist  = 0;
+      size_t _maxIndex = _segment.first;
+
+      for (size_t i = _segment.first + 1; i < _segment.second; i++) {
+        float _dist = _Distance(_timeStart, _valueStart, _timeEnd, _valueEnd, Data[i][0], Data[i][1]);
+
+        if (_dist > _maxDist) {
+          _maxDist  = _dist;
+          _maxIndex = i;
+        }
+      }
+
+      if (_maxDist > _epsilon) {
+        Keep[_maxIndex] = true;
+        _stack.emplace_back(_segment.first, _maxIndex);
+        _stack.emplace_back(_maxIndex, _segment.second);
+      }
+    }
+
+    return _stack.capacity() * sizeof(_stack[0]);
+  }
+
+  void _Cut(Table &Data) {
+    while (Data.rows() > _maxSize)
+      Data.remove(0);
+  }
+
+  static bool _Output(Table &Data, _SeriesBuffer &Out) {
+    if (!Out.setCapacity(max(Data.rows(), (size_t)1)))
+      return false;
+
+    Out.clear();
+
+    for (size_t i = 0; i < Data.rows(); i++)
+      Out.append((uint64_t)Data[i][0], (float)Data[i][1]);
+
+    return true;
+  }
+
+public:
+  _TableCompressor(size_t MaxSize, float Epsilon) : _maxSize(MaxSize), _epsilon(Epsilon) {
+  }
+
+  size_t PeakBytes() const override {
+    return _peak;
+  }
+};
+
+// прежний plot_table.h: сырые точки в Table, при переполнении RDP по всей таблице и обрезка начала
+class _TableRdpCompressor : public _TableCompressor {
+private:
+  void _Compress(Table &Data) {
+    const size_t _rows = Data.rows();
+
+    std::vector<bool> _keep(_rows, false);
+    _keep.front() = true;
+    _keep.back()  = true;
+
+    const size_t _stackBytes = _Mark(Data, _keep);
+
+    Table _compressed(0, 2, cell_t::Uint64, cell_t::Float);
+
+    for (size_t i = 0; i < _rows; i++) {
+      if (_keep[i])
+        _compressed.append((uint64_t)Data[i][0], (float)Data[i][1]);
+    }
+
+    _peak = max(_peak, _rows * ROW_BYTES + _compressed.rows() * ROW_BYTES + (_rows + 7) / 8 + _stackBytes);
+
+    _Cut(_compressed);
+
+    Data.removeAll();
+
+    for (size_t i = 0; i < _compressed.rows(); i++)
+      Data.append((uint64_t)_compressed[i][0], (float)_compressed[i][1]);
+  }
+
+public:
+  _TableRdpCompressor(size_t MaxSize, float Epsilon) : _TableCompressor(MaxSize, Epsilon) {
+  }
+
+  const char *Name() const override {
+    return "table rdp";
+  }
+
+  bool Run(const _SeriesView &Trace, _SeriesBuffer &Out) override {
+    Table _data(0, 2, cell_t::Uint64, cell_t::Float);
+
+    _peak = 0;
+
+    for (size_t i = 0; i < Trace.size(); i++) {
+      _data.append(Trace.Time(i), Trace.Value(i));
+
+      if ((_epsilon > 0) && (_data.rows() > _maxSize) && (_data.rows() > 2))
+        _Compress(_data);
+
+      _Cut(_data);
+
+      _peak = max(_peak, _data.rows() * ROW_BYTES);
+    }
+
+    return _Output(_data, Out);
+  }
+};
+
+// прежний _rdp.h: сырые точки копятся в _temp до MaxSize, RDP идёт только по этому окну, оставленные дописываются
+// в _data с обрезкой начала; последняя точка окна остаётся в _temp началом следующего
+class _WindowRdpCompressor : public _TableCompressor {
+private:
+  void _Compress(Table &Data, Table &Temp) {
+    const size_t _rows = Temp.rows();
+
+    if (_rows < 1)
+      return;
+
+    std::vector<bool> _keep(_rows, _epsilon <= 0);
+
+    const size_t _stackBytes = ((_epsilon > 0) && (_rows > 2)) ? _Mark(Temp, _keep) : 0;
+
+    _keep.front() = (Data.rows() < 1);
+    _keep.back()  = true;
+
+    for (size_t i = 0; i < _rows; i++) {
+      if (_keep[i])
+        Data.append((uint64_t)Temp[i][0], (float)Temp[i][1]);
+    }
+
+    _peak = max(_peak, (Data.rows() + _rows) * ROW_BYTES + (_rows + 7) / 8 + _stackBytes);
+
+    _Cut(Data);
+
+    Temp.removeAll();
+    Temp.append((uint64_t)Data[Data.rows() - 1][0], (float)Data[Data.rows() - 1][1]);
+  }
+
+public:
+  _WindowRdpCompressor(size_t MaxSize, float Epsilon) : _TableCompressor(MaxSize, Epsilon) {
+  }
+
+  const char *Name() const override {
+    return "window rdp";
+  }
+
+  bool Run(const _SeriesView &Trace, _SeriesBuffer &Out) override {
+    Table _data(0, 2, cell_t::Uint64, cell_t::Float);
+    Table _temp(0, 2, cell_t::Uint64, cell_t::Float);
+
+    _peak = 0;
+
+    for (size_t i = 0; i < Trace.size(); i++) {
+      _temp.append(Trace.Time(i), Trace.Value(i));
+
+      if (_temp.rows() > _maxSize)
+        _Compress(_data, _temp);
+    }
+
+    // хвост окна - как при чтении Data() в прежнем _Plot
+    if (_temp.rows() > 1 || _data.rows() < 1)
+      _Compress(_data, _temp);
+
+    return _Output(_data, Out);
+  }
+};
+
+// Прогоняет трассу через все добавленные компрессоры: время, пиковая память, число точек,
+// ошибка линейного восстановления по точкам трассы внутри покрытого результатом интервала
+class _PlotBench {
+private:
+  std::vector<_PlotCompressor *> _compressors;
+
+  struct _Error {
+    float  Max     = 0;
+    double Sum     = 0;
+    size_t Covered = 0;
+
+    float Mean() const {
+      return (Covered > 0) ? static_cast<float>(Sum / Covered) : 0;
+    }
+  };
+
+  static _Error _Measure(const _SeriesView &Trace, const _SeriesBuffer &Out) {
+    _Error _result;
+
+    if (Out.size() < 1)
+      return _result;
+
+    size_t j = 0;
+
+    for (size_t i = 0; i < Trace.size(); i++) {
+      const uint64_t _time = Trace.Time(i);
+
+      if ((_time < Out.Time(0)) || (_time > Out.LastTime()))
+        continue;
+
+      while ((j + 1 < Out.size()) && (Out.Time(j + 1) < _time))
+        j++;
+
+      float _value = Out.Value(j);
+
+      if ((j + 1 < Out.size()) && (Out.Time(j + 1) > Out.Time(j))) {
+        const float _k = static_cast<float>(_time - Out.Time(j)) / static_cast<float>(Out.Time(j + 1) - Out.Time(j));
+
+        _value += _k * (Out.Value(j + 1) - Out.Value(j));
+      }
+
+      const float _error = fabsf(Trace.Value(i) - _value);
+
+      _result.Max = max(_result.Max, _error);
+      _result.Sum += _error;
+      _result.Covered++;
+    }
+
+    return _result;
+  }
+
+public:
+  _PlotBench() {
+  }
+
+  void add(_PlotCompressor &Compressor) {
+    _compressors.push_back(&Compressor);
+  }
+
+  void Run(const char *TraceName, const _SeriesView &Trace, Print &Log) {
+    Log.printf("%s: %u pts\n", TraceName, (uint)Trace.size());
+
+    if (Trace.size() < 2)
+      return;
+
+    _SeriesBuffer _out;
+
+    for (_PlotCompressor *_compressor : _compressors) {
+      ulong _micros = micros();
+      bool  _ok     = _compressor->Run(Trace, _out);
+
+      _micros = micros() - _micros;
+
+      if (!_ok) {
+        Log.printf("  %s: out of memory\n", _compressor->Name());
+        continue;
+      }
+
+      const _Error _error = _Measure(Trace, _out);
+
+      Log.printf("  %s: %lu us, peak %u B, kept %u, err max %.4f avg %.4f, covered %u\n",
+                 _compressor->Name(),
+                 _micros,
+                 (uint)_compressor->PeakBytes(),
+                 (uint)_out.size(),
+                 _error.Max,
+                 _error.Mean(),
+                 (uint)_error.Covered);
+    }
+  }
+};
@@ -0,0 +1,152 @@
+// Кольцо долгой истории на разделе-файле (host::addPartition): запись через persist, переполнение кольца,
+// чтение после "перезагрузки", индекс по времени и пропуск битых записей
+
+#include "_flashlog.h"
+#include "check.h"
+#include "host.h"
+
+#include <cstdio>
+#include <vector>
+
+#define TEST_LABEL   "history"
+#define TEST_PATH    "test_flashlog.bin"
+#define TEST_SECTORS 8
+#define TEST_START   1700000000000ull
+#define TEST_STEP    1000ull
+
+struct _Point {
+  uint64_t UnixMs;
+  float    Value;
+};
+
+static std::vector<_Point> read(_FlashLog &Log, uint16_t Channel, uint64_t From = 0, uint64_t To = UINT64_MAX) {
+  std::vector<_Point> result;
+
+  Log.forEach(Channel, From, To, [&result](const _FlashRecord &Record) { result.push_back({Record.UnixMs, Record.Value}); });
+
+  return result;
+}
+
+static void checkSeries(const std::vector<_Point> &Points, size_t Appended) {
+  CHECK(!Points.empty());
+
+  for (size_t i = 0; i < Points.size(); i++) {
+    const size_t n = static_cast<size_t>(Points[i].Value);
+
+    CHECK(Points[i].UnixMs == TEST_START + n * TEST_STEP);
+
+    if (i > 0)
+      CHECK(Points[i].UnixMs > Points[i - 1].UnixMs);
+  }
+
+  CHECK(static_cast<size_t>(Points.back().Value) == Appended - 2);
+}
+
+int main() {
+  remove(TEST_PATH);
+
+  host::addPartition(TEST_LABEL, FLASH_LOG_SUBTYPE, TEST_SECTORS * SPI_FLASH_SEC_SIZE, TEST_PATH);
+
+  // больше ёмкости кольца: два канала вперемешку, канал 1 - каждая вторая запись
+  const size_t appended = 3000;
+
+  {
+    _FlashLog log(TEST_LABEL);
+
+    CHECK(log.Begin());
+
+    const size_t writes = host::partitionWrites();
+
+    for (size_t i = 0; i < 10; i++)
+      log.append(i % 2, TEST_START + i * TEST_STEP, i);
+
+    // в loop запись только копится
+    CHECK(host::partitionWrites() == writes);
+    CHECK(log.Pending() == 10);
+    CHECK(read(log, 0).size() == 5);
+
+    for (size_t i = 10; i < appended; i++)
+      CHECK(log.append(i % 2, TEST_START + i * TEST_STEP, i));
+
+    CHECK(log.flush());
+    CHECK(log.Pending() == 0);
+    CHECK(log.Dropped() == 0);
+    CHECK(log.Records() <= log.Capacity());
+    CHECK(log.Records() > log.Capacity() - SPI_FLASH_SEC_SIZE / sizeof(_FlashRecord));
+    CHECK(host::partitionErases() > TEST_SECTORS);
+
+    checkSeries(read(log, 0), appended);
+  }
+
+  // "перезагрузка": тот же файл, новый журнал
+  {
+    _FlashLog log(TEST_LABEL);
+
+    CHECK(log.Begin());
+
+    const std::vector<_Point> all = read(log, 0);
+
+    checkSeries(all, appended);
+    CHECK(log.Scanned() == TEST_SECTORS);
+
+    // последние 100 секунд - только сектор головы и, может быть, предыдущий
+    const uint64_t            from   = TEST_START + (appended - 100) * TEST_STEP;
+    const std::vector<_Point> recent = read(log, 0, from);
+
+    CHECK(log.Scanned() <= 2);
+    CHECK(recent.size() == 50);
+
+    size_t expected = 0;
+
+    for (const _Point &p : all) {
+      if (p.UnixMs >= from)
+        expected++;
+    }
+
+    CHECK(recent.size() == expected);
+
+    // группы по минуте: столько же, сколько минут в интервале
+    size_t groups = 0;
+    size_t points = 0;
+
+    log.aggregate(0, from, UINT64_MAX, 60000ull, [&](const _SeriesAggregate &Group) {
+      groups++;
+      points += Group.Count;
+    });
+
+    CHECK(points == recent.size());
+    CHECK(groups >= 2 && groups <= 3);
+
+    // после чтения дописывание продолжается с головы
+    const size_t records = log.Records();
+
+    CHECK(log.append(0, TEST_START + appended * TEST_STEP, appended));
+    CHECK(log.flush());
+    CHECK(log.Records() == records + 1);
+    CHECK(read(log, 0).back().Value == appended);
+  }
+
+  // битая запись (биты сброшены записью поверх) пропускается, соседние читаются
+  {
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, static_cast<esp_partition_subtype_t>(FLASH_LOG_SUBTYPE), TEST_LABEL);
+
+    _FlashLog log(TEST_LABEL);
+
+    CHECK(log.Begin());
+
+    const size_t before = read(log, 0).size() + read(log, 1).size();
+
+    // первая запись какого-то сектора: слот 1
+    const uint8_t zeros[4] = {0, 0, 0, 0};
+
+    CHECK(esp_partition_write(partition, 2 * SPI_FLASH_SEC_SIZE + sizeof(_FlashRecord) + 8, zeros, sizeof(zeros)) == ESP_OK);
+
+    CHECK(read(log, 0).size() + read(log, 1).size() == before - 1);
+  }
+
+  host::removePartitions();
+
+  remove(TEST_PATH);
+
+  return TEST_RESULT();
+}
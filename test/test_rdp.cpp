@@ -0,0 +1,183 @@
+// Сжатие графиков на детерминированных трассах: пила и шум из LCG.
+// Swing door: каждый исходный образец не дальше epsilon по вертикали от ломаной из оставленных точек.
+// RDP: каждый исходный образец не дальше epsilon по перпендикуляру от своего итогового отрезка.
+
+#include "_rdp.h"
+#include "check.h"
+#include "host.h"
+
+#include <vector>
+
+#define TRACE_START     1700000000000ull
+#define TRACE_STEP      1000ull
+#define TRACE_SIZE      2000
+#define FLOAT_TOLERANCE 1e-4
+
+struct _Point {
+  uint64_t Time;
+  float    Value;
+};
+
+using _Trace = std::vector<_Point>;
+
+static _Trace sawtooth(size_t Count, size_t Period, float Amplitude) {
+  _Trace result;
+
+  for (size_t i = 0; i < Count; i++)
+    result.push_back({TRACE_START + i * TRACE_STEP, Amplitude * static_cast<float>(i % Period) / Period});
+
+  return result;
+}
+
+// шум +-Amplitude вокруг медленного дрейфа; LCG, чтобы прогон повторялся
+static _Trace noise(size_t Count, float Amplitude) {
+  _Trace   result;
+  uint32_t seed = 12345;
+
+  for (size_t i = 0; i < Count; i++) {
+    seed = seed * 1664525u + 1013904223u;
+
+    const float unit = static_cast<float>(seed >> 8) / static_cast<float>(1u << 24);
+
+    result.push_back({TRACE_START + i * TRACE_STEP, 20.0f + 0.001f * i + Amplitude * (2 * unit - 1)});
+  }
+
+  return result;
+}
+
+static void feed(_Plot &Plot, const _Trace &Trace) {
+  for (const _Point &p : Trace)
+    Plot.putValue(p.Time, p.Value);
+}
+
+// индекс отрезка оставленных точек [k, k + 1], в котором лежит Time
+static size_t segmentOf(const _SeriesBuffer &Kept, uint64_t Time) {
+  size_t k = 0;
+
+  while ((k + 2 < Kept.size()) && (Kept.Time(k + 1) < Time))
+    k++;
+
+  return k;
+}
+
+static double verticalError(const _SeriesBuffer &Kept, const _Point &p) {
+  const size_t k = segmentOf(Kept, p.Time);
+
+  const double dt = static_cast<double>(Kept.Time(k + 1) - Kept.Time(k));
+  const double at = Kept.Value(k) + (Kept.Value(k + 1) - Kept.Value(k)) * static_cast<double>(p.Time - Kept.Time(k)) / dt;
+
+  return fabs(p.Value - at);
+}
+
+// в тех же координатах, что и _Plot::_Line: (мс от начала отрезка, значение)
+static double perpendicularError(const _SeriesBuffer &Kept, const _Point &p) {
+  const size_t k = segmentOf(Kept, p.Time);
+
+  const double dt = static_cast<double>(Kept.Time(k + 1) - Kept.Time(k));
+  const double dv = Kept.Value(k + 1) - Kept.Value(k);
+  const double x  = static_cast<double>(p.Time - Kept.Time(k));
+  const double y  = p.Value - Kept.Value(k);
+
+  return fabs(dv * x - dt * y) / sqrt(dt * dt + dv * dv);
+}
+
+// оставленные точки - подмножество исходных, концы трассы на месте
+static void checkShape(const _SeriesBuffer &Kept, const _Trace &Trace) {
+  CHECK(Kept.size() >= 2);
+  CHECK(Kept.size() < Trace.size());
+  CHECK(Kept.Time(0) == Trace.front().Time);
+  CHECK(Kept.LastTime() == Trace.back().Time);
+  CHECK(Kept.LastValue() == Trace.back().Value);
+
+  for (size_t i = 1; i < Kept.size(); i++)
+    CHECK(Kept.Time(i) > Kept.Time(i - 1));
+}
+
+static void testSwingDoor(const char *Name, const _Trace &Trace, float Epsilon) {
+  _Plot plot(_SubType::Humidity, 4096, Epsilon);
+
+  CHECK(plot.begin());
+
+  feed(plot, Trace);
+
+  const _SeriesBuffer &kept = plot.Series();
+
+  checkShape(kept, Trace);
+
+  double worst = 0;
+
+  for (const _Point &p : Trace)
+    worst = max(worst, verticalError(kept, p));
+
+  printf("swing door %-8s eps %.3f: %u -> %u, max error %.4f\n", Name, Epsilon, (uint)Trace.size(), (uint)kept.size(), worst);
+
+  CHECK_LE(worst, Epsilon + FLOAT_TOLERANCE);
+  CHECK_LE(plot.Stat().MaxError, Epsilon + FLOAT_TOLERANCE);
+}
+
+static void testRdp(const char *Name, const _Trace &Trace, float Epsilon) {
+  // epsilon 0 - swing door пропускает всё, затем пакетный RDP по полной трассе
+  _Plot plot(_SubType::Humidity, 4096, 0);
+
+  CHECK(plot.begin());
+
+  feed(plot, Trace);
+
+  CHECK(plot.Series().size() == Trace.size());
+
+  plot.setEpsilon(Epsilon);
+
+  const _SeriesBuffer &kept = plot.Series();
+
+  checkShape(kept, Trace);
+
+  double worst = 0;
+
+  for (const _Point &p : Trace)
+    worst = max(worst, perpendicularError(kept, p));
+
+  printf("rdp        %-8s eps %.3f: %u -> %u, max error %.4f\n", Name, Epsilon, (uint)Trace.size(), (uint)kept.size(), worst);
+
+  CHECK_LE(worst, Epsilon + FLOAT_TOLERANCE);
+  CHECK_LE(plot.Stat().CompressMaxError, Epsilon + FLOAT_TOLERANCE);
+}
+
+// полный буфер огрубляется окнами: размер в пределах лимита, порядок и живой хвост сохранены
+static void testRelax(const _Trace &Trace) {
+  const size_t size = 64;
+
+  _Plot plot(_SubType::Humidity, size, 0.05f);
+
+  CHECK(plot.begin());
+
+  feed(plot, Trace);
+
+  const _SeriesBuffer &kept = plot.Series();
+
+  printf("relax      noise    eps %.3f -> %.3f: %u -> %u, compress %lu\n", 0.05f, plot.Epsilon(), (uint)Trace.size(), (uint)kept.size(), (ulong)plot.Stat().CompressCount);
+
+  CHECK(kept.size() <= size);
+  CHECK(plot.Epsilon() > 0.05f);
+  CHECK(plot.Stat().CompressCount > 0);
+  CHECK(kept.LastTime() == Trace.back().Time);
+
+  for (size_t i = 1; i < kept.size(); i++)
+    CHECK(kept.Time(i) > kept.Time(i - 1));
+}
+
+int main() {
+  const _Trace saw   = sawtooth(TRACE_SIZE, 60, 10.0f);
+  const _Trace noisy = noise(TRACE_SIZE, 1.0f);
+
+  for (float epsilon : {0.05f, 0.25f, 1.0f}) {
+    testSwingDoor("sawtooth", saw, epsilon);
+    testSwingDoor("noise", noisy, epsilon);
+
+    testRdp("sawtooth", saw, epsilon);
+    testRdp("noise", noisy, epsilon);
+  }
+
+  testRelax(noisy);
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+// Трассы для хост-бенчмарков: записанные самописцем (CSV из tools/blackbox_decode.py) или синтетические сутки,
+// похожие на теплицу, с разрешением датчиков DHT/AM2320 (0.1) и MH-Z19 (1 ppm)
+
+#include "_series.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+#define TRACE_SYNTHETIC_START  1700000000000ull
+#define TRACE_SYNTHETIC_STEP   10000ull // опрос датчиков
+#define TRACE_SYNTHETIC_POINTS 8640     // сутки
+
+struct _BenchTrace {
+  std::string   Name;
+  _SeriesBuffer Data;
+};
+
+using _BenchTraces = std::vector<_BenchTrace *>;
+
+static float _TraceQuantize(float Value, float Step) {
+  return roundf(Value / Step) * Step;
+}
+
+static uint32_t _TraceRandom(uint32_t &Seed) {
+  Seed = Seed * 1664525u + 1013904223u;
+
+  return Seed >> 8;
+}
+
+// -1..1
+static float _TraceNoise(uint32_t &Seed) {
+  return 2.0f * _TraceRandom(Seed) / static_cast<float>(1u << 24) - 1.0f;
+}
+
+static _BenchTrace *_TraceNew(const char *Name, size_t Count) {
+  _BenchTrace *_trace = new _BenchTrace();
+
+  _trace->Name = Name;
+  _trace->Data.setCapacity(Count);
+
+  return _trace;
+}
+
+// суточный ход температуры, увлажнитель включается ступенькой, CO2 копится и сбрасывается проветриванием
+static void TraceSynthetic(_BenchTraces &Traces) {
+  _BenchTrace *_temperature = _TraceNew("temperature_in", TRACE_SYNTHETIC_POINTS);
+  _BenchTrace *_humidity    = _TraceNew("humidity_in", TRACE_SYNTHETIC_POINTS);
+  _BenchTrace *_co2         = _TraceNew("co2_in", TRACE_SYNTHETIC_POINTS);
+
+  uint32_t _seed    = 12345;
+  float    _wet     = 60;
+  float    _ppm     = 450;
+  bool     _wetting = false;
+  bool     _venting = false;
+
+  for (size_t i = 0; i < TRACE_SYNTHETIC_POINTS; i++) {
+    const uint64_t _time = TRACE_SYNTHETIC_START + i * TRACE_SYNTHETIC_STEP;
+    const float    _day  = 2.0f * M_PI * i / TRACE_SYNTHETIC_POINTS;
+
+    _temperature->Data.append(_time, _TraceQuantize(22.0f + 4.0f * sinf(_day) + 0.15f * _TraceNoise(_seed), 0.1f));
+
+    if (_wet < 55)
+      _wetting = true;
+    else if (_wet > 70)
+      _wetting = false;
+
+    _wet += _wetting ? 0.2f : -0.01f;
+    _humidity->Data.append(_time, _TraceQuantize(_wet + 0.3f * _TraceNoise(_seed), 0.1f));
+
+    if (_ppm > 1200)
+      _venting = true;
+    else if (_ppm < 500)
+      _venting = false;
+
+    _ppm += _venting ? -15.0f : 0.8f;
+    _co2->Data.append(_time, _TraceQuantize(_ppm + 10.0f * _TraceNoise(_seed), 1.0f));
+  }
+
+  Traces.push_back(_temperature);
+  Traces.push_back(_humidity);
+  Traces.push_back(_co2);
+}
+
+// "2024-05-01T12:00:00.250000+00:00" -> unix ms
+static bool _TraceParseTime(const char *Text, uint64_t &UnixMs) {
+  struct tm _tm = {};
+  double    _seconds = 0;
+
+  if (sscanf(Text, "%d-%d-%dT%d:%d:%lf", &_tm.tm_year, &_tm.tm_mon, &_tm.tm_mday, &_tm.tm_hour, &_tm.tm_min, &_seconds) != 6)
+    return false;
+
+  _tm.tm_year -= 1900;
+  _tm.tm_mon -= 1;
+
+  UnixMs = static_cast<uint64_t>(timegm(&_tm)) * 1000ull + static_cast<uint64_t>(_seconds * 1000.0 + 0.5);
+
+  return true;
+}
+
+// CSV tools/blackbox_decode.py: time,boot_ms,kind,source,value; берём записи sample, по трассе на источник
+static bool TraceLoadBlackbox(const char *Path, _BenchTraces &Traces) {
+  FILE *f = fopen(Path, "r");
+
+  if (!f)
+    return false;
+
+  struct _Point {
+    uint64_t Time;
+    float    Value;
+  };
+
+  std::map<std::string, std::vector<_Point>> _sources;
+
+  char _line[256];
+
+  while (fgets(_line, sizeof(_line), f)) {
+    char *_fields[5] = {};
+    char *_cursor    = _line;
+
+    for (size_t i = 0; i < 5; i++) {
+      _fields[i] = _cursor;
+
+      _cursor = _cursor ? strchr(_cursor, ',') : nullptr;
+
+      if (_cursor)
+        *_cursor++ = 0;
+    }
+
+    if (!_fields[4] || strcmp(_fields[2], "sample"))
+      continue;
+
+    uint64_t _time = 0;
+
+    // до синхронизации часов время - millis() от старта, такие записи в трассу не идут
+    if (!_TraceParseTime(_fields[0], _time))
+      continue;
+
+    _sources[_fields[3]].push_back({_time, strtof(_fields[4], nullptr)});
+  }
+
+  fclose(f);
+
+  for (auto &_source : _sources) {
+    _BenchTrace *_trace = _TraceNew(_source.first.c_str(), _source.second.size());
+
+    for (const _Point &_point : _source.second)
+      _trace->Data.append(_point.Time, _point.Value);
+
+    Traces.push_back(_trace);
+  }
+
+  return !_sources.empty();
+}
+
+// трассы из файлов в аргументах, без аргументов - синтетические
+static void TraceLoad(int argc, char **argv, _BenchTraces &Traces) {
+  for (int i = 1; i < argc; i++) {
+    if (!TraceLoadBlackbox(argv[i], Traces))
+      fprintf(stderr, "%s: no samples\n", argv[i]);
+  }
+
+  if (Traces.empty())
+    TraceSynthetic(Traces);
+}
+
+static void TraceFree(_BenchTraces &Traces) {
+  for (_BenchTrace *_trace : Traces)
+    delete _trace;
+
+  Traces.clear();
+}
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Разбор дампа самописца (раздел blackbox, см. src/_blackbox.h) в CSV.
+
+Дамп снимается с платы:
+    esptool.py read_flash 0x3B0000 0x40000 blackbox.bin
+    python3 tools/blackbox_decode.py blackbox.bin > blackbox.csv
+
+Раскладка (src/_flashlog.h): раздел - кольцо секторов по 4096 байт. Слот 0 сектора - заголовок
+<magic u32 "FLB1", sequence u32, reserved u32, crc32 u32>, дальше 255 записей
+<time u64, value f32, channel u16, crc16 u16>. Старший байт канала - вид записи (+0x80, если время -
+millis() от старта), младший - источник.
+"""
+
+import argparse
+import csv
+import datetime
+import struct
+import sys
+import zlib
+
+SECTOR_SIZE = 4096
+RECORD = struct.Struct("<QfHH")
+HEADER = struct.Struct("<IIII")
+MAGIC = 0x31424C46  # "FLB1", у долгой истории - "FLG1"
+
+BOOT_TIME = 0x80
+
+KINDS = {0: "boot", 1: "sample", 2: "event"}
+
+# каналы графиков, _PlotList::Channel
+SAMPLES = ["temperature_in", "humidity_in", "co2_in", "temperature_out", "humidity_out", "co2_out"]
+
+# _SubType устройств
+DEVICES = {7: "fan_main", 8: "fan_inner", 9: "humidifier", 10: "heater"}
+
+
+def crc16_le(data):
+    crc = 0xFFFF
+
+    for byte in data:
+        crc ^= byte
+
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8408 if crc & 1 else crc >> 1
+
+    return ~crc & 0xFFFF
+
+
+def sectors(image):
+    found = []
+
+    for offset in range(0, len(image) - SECTOR_SIZE + 1, SECTOR_SIZE):
+        magic, sequence, reserved, crc = HEADER.unpack_from(image, offset)
+
+        if magic == MAGIC and crc == zlib.crc32(image[offset:offset + 12]):
+            found.append((sequence, offset))
+
+    # номер сектора растёт и может переполниться u32 - порядок по возрасту относительно самого нового, старые первыми
+    if not found:
+        return []
+
+    newest = max(found, key=lambda item: item[0])[0]
+
+    return [offset for sequence, offset in sorted(found, key=lambda item: (newest - item[0]) & 0xFFFFFFFF, reverse=True)]
+
+
+def records(image):
+    for offset in sectors(image):
+        for slot in range(1, SECTOR_SIZE // RECORD.size):
+            raw = image[offset + slot * RECORD.size:offset + (slot + 1) * RECORD.size]
+
+            if raw == b"\xff" * RECORD.size:
+                break
+
+            time, value, channel, crc = RECORD.unpack(raw)
+
+            yield time, value, channel, crc == crc16_le(raw[:14])
+
+
+def source_name(kind, source):
+    if kind == 1:
+        return SAMPLES[source] if source < len(SAMPLES) else str(source)
+
+    if kind == 2:
+        return DEVICES.get(source, str(source))
+
+    return ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", help="образ раздела blackbox")
+    parser.add_argument("--bad", action="store_true", help="выводить и записи с неверным CRC")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as f:
+        image = f.read()
+
+    out = csv.writer(sys.stdout)
+    out.writerow(["time", "boot_ms", "kind", "source", "value"])
+
+    bad = 0
+
+    for time, value, channel, ok in records(image):
+        if not ok:
+            bad += 1
+
+            if not args.bad:
+                continue
+
+        kind = (channel >> 8) & ~BOOT_TIME
+        source = channel & 0xFF
+
+        if (channel >> 8) & BOOT_TIME:
+            stamp, boot_ms = "", time
+        else:
+            stamp, boot_ms = datetime.datetime.fromtimestamp(time / 1000, datetime.timezone.utc).isoformat(), ""
+
+        out.writerow([stamp, boot_ms, KINDS.get(kind, kind), source_name(kind, source), "%g" % value])
+
+    if bad:
+        print("%d records with bad CRC" % bad, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()